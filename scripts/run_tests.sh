@@ -10,13 +10,19 @@ set -o xtrace
 
 for file in t86-cli/tests/*.in; do
     ref="${file%.in}.ref"
-    ${1} run ${file} > "test_out.tmp"
-    if ! diff "test_out.tmp" "${file%.in}.ref" >"diff_out.tmp"; then
-        echo "Test ${file} failed"
-        cat diff_out.tmp
-        exit 1
-    fi
-    rm diff_out.tmp test_out.tmp
+    for mode in "" "-functional" "-speculativeLoads=1" "-resolveBranchesAtExecute=1" \
+                "-fetchWidth=4 -decodeWidth=4 -dispatchWidth=4 -aluCnt=4" "-functionalUnits=1" \
+                "-l1dSets=4 -l1dReplacement=plru -l2Sets=16" "-ramBanks=4 -ramRowSize=4 -ramReadPorts=1 -ramWritePorts=1" \
+                "-prefetcher=stride -prefetchDegree=2" \
+                "-speculativeLoads=1 -reservationStationEntriesCnt=32 -aluCnt=4 -ramReadLatency=30 -ramWriteLatency=1"; do
+        ${1} run ${mode} ${file} > "test_out.tmp"
+        if ! diff "test_out.tmp" "${file%.in}.ref" >"diff_out.tmp"; then
+            echo "Test ${file} ${mode} failed"
+            cat diff_out.tmp
+            exit 1
+        fi
+        rm diff_out.tmp test_out.tmp
+    done
 done
 
 echo "All tests passed :-)"
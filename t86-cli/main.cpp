@@ -3,6 +3,7 @@
 
 #include "../common/config.h"
 #include "../t86/utils/stats_logger.h"
+#include "../t86/utils/trace.h"
 #include "parser.h"
 
 using namespace tiny::t86;
@@ -12,10 +13,30 @@ using tiny::config;
 const char* usage_str = R"(
 Usage: t86-cli command
 commands:
-    run [-stats] input - Parses input, which must be valid T86 assembly file, and runs it on the VM.
+    run [-stats] [-streamingStats] [-trace=file] [-traceMmap] [-functional] input - Parses input, which must be valid T86 assembly file, and runs it on the VM.
+        -streamingStats makes -stats keep only running totals, so long runs do not run out of memory.
+        -trace writes the pipeline events of every instruction to a binary trace file, -traceMmap writes it through a memory mapping.
+        -functional executes instructions in order without the pipeline and timing model.
+    trace input - Converts a binary trace to text, one event per line.
 )";
 
+int convertTrace(const char* fname) {
+    try {
+        TraceReader reader(fname);
+        while (auto event = reader.next()) {
+            std::cout << event->toString() << '\n';
+        }
+    } catch (std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc == 3 && std::string(argv[1]) == "trace") {
+        return convertTrace(argv[2]);
+    }
     if (argc < 2 || std::string(argv[1]) != "run") {
         std::cerr << usage_str;
         return 1;
@@ -38,9 +59,23 @@ int main(int argc, char* argv[]) {
     }
 
     bool enableStats = !config.setDefaultIfMissing("-stats", "");
+    bool streamingStats = !config.setDefaultIfMissing("-streamingStats", "");
+    bool functional = !config.setDefaultIfMissing("-functional", "");
+    bool traceMmap = !config.setDefaultIfMissing("-traceMmap", "");
+    config.setDefaultIfMissing("-trace", "");
+    std::string traceFile = config.get("-trace");
 
-    if(enableStats)
-        StatsLogger::instance().enableLoggingAndReset();
+    // Without -stats only the trace is wanted, so the stats keep just the running totals
+    if(enableStats || !traceFile.empty())
+        StatsLogger::instance().enableLoggingAndReset(streamingStats || !enableStats);
+    if(!traceFile.empty()) {
+        try {
+            StatsLogger::instance().enableTrace(traceFile, traceMmap);
+        } catch (std::runtime_error& err) {
+            std::cerr << err.what() << std::endl;
+            return 3;
+        }
+    }
     
     Parser parser(f);
     tiny::t86::Program program;
@@ -58,8 +93,14 @@ int main(int argc, char* argv[]) {
 
     cpu.start(std::move(program));
     try {
-        while (!cpu.halted()) {
-            cpu.tick();
+        if (functional) {
+            while (!cpu.halted()) {
+                cpu.step();
+            }
+        } else {
+            while (!cpu.halted()) {
+                cpu.tick();
+            }
         }
     } catch(std::exception &ex) {
         utils::output(std::cerr, "Exception {} while ticking CPU: {}", typeid(ex).name(), ex.what());
@@ -68,6 +109,7 @@ int main(int argc, char* argv[]) {
         throw ex; // rethrow for debugger
     }
 
+    StatsLogger::instance().closeTrace();
     if(enableStats)
         StatsLogger::instance().processBasicStats(std::cerr);
 }
@@ -591,6 +591,9 @@ public:
             CHECK_COMMA();
             auto from = FloatRegister();
             return new tiny::t86::NRW{dest, from};
+        } else if (ins_name == "PREFETCH") {
+            auto address = Operand();
+            return new tiny::t86::PREFETCH{address};
         } else if (ins_name == "NOP") {
             return new tiny::t86::NOP{};
         } else {
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "cache.h"
+#include "utils/stats_logger.h"
+#include "../common/helpers.h"
+
+namespace tiny::t86 {
+    Cache::Replacement Cache::parseReplacement(const std::string& name) {
+        if (name == "lru") {
+            return Replacement::Lru;
+        } else if (name == "plru") {
+            return Replacement::PseudoLru;
+        }
+        throw std::runtime_error(utils::format("Unknown cache replacement policy {}, use lru or plru", name));
+    }
+
+    Cache::Cache(std::string name, const Config& config)
+            : name_(std::move(name)), config_(config), lines_(config.sets * config.ways) {
+        if (!config_.sets || !config_.ways || !config_.lineSize || !config_.mshrCnt) {
+            throw std::runtime_error(utils::format("Cache {} needs at least one set, way, word in a line and MSHR", name_));
+        }
+        if (config_.replacement == Replacement::PseudoLru) {
+            if (config_.ways & (config_.ways - 1)) {
+                throw std::runtime_error(utils::format("Pseudo-LRU cache {} needs a power of two ways", name_));
+            }
+            plruBits_.resize(config_.sets * config_.ways);
+        }
+    }
+
+    Cache::Line* Cache::find(std::size_t line) {
+        Line* set = &lines_[(line % config_.sets) * config_.ways];
+        for (std::size_t i = 0; i < config_.ways; ++i) {
+            if (set[i].valid && set[i].tag == line / config_.sets) {
+                return &set[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool Cache::contains(std::size_t address) const {
+        std::size_t line = address / config_.lineSize;
+        auto set = lines_.begin() + (line % config_.sets) * config_.ways;
+        return std::any_of(set, set + config_.ways,
+                           [this, line](const Line& l) { return l.valid && l.tag == line / config_.sets; });
+    }
+
+    void Cache::touch(Line* line) {
+        line->lastUse = ++useCounter_;
+        if (config_.replacement == Replacement::PseudoLru) {
+            // Nodes of a set are a heap from index 1, way i is the leaf ways + i
+            std::size_t index = line - lines_.data();
+            auto bits = plruBits_.begin() + (index - index % config_.ways);
+            for (std::size_t node = config_.ways + index % config_.ways; node > 1; node /= 2) {
+                bits[node / 2] = node % 2 == 0;
+            }
+        }
+    }
+
+    std::optional<std::size_t> Cache::install(std::size_t line, bool dirty, std::size_t readyTick) {
+        std::size_t first = (line % config_.sets) * config_.ways;
+        Line* set = &lines_[first];
+        // Invalid lines have lastUse 0, so they go first with both policies
+        Line* victim = std::min_element(set, set + config_.ways,
+                                        [](const Line& a, const Line& b) { return a.lastUse < b.lastUse; });
+        if (victim->valid && config_.replacement == Replacement::PseudoLru) {
+            std::size_t node = 1;
+            while (node < config_.ways) {
+                node = 2 * node + plruBits_[first + node];
+            }
+            victim = &set[node - config_.ways];
+        }
+        std::optional<std::size_t> evicted;
+        if (victim->valid && victim->prefetched) {
+            StatsLogger::instance().logUselessPrefetch();
+        }
+        if (victim->valid && victim->dirty) {
+            evicted = (victim->tag * config_.sets + line % config_.sets) * config_.lineSize;
+            StatsLogger::instance().logCacheWriteBack(name_);
+        }
+        *victim = Line{true, dirty, false, line / config_.sets, readyTick, 0};
+        touch(victim);
+        return evicted;
+    }
+
+    std::optional<std::size_t> Cache::lookup(std::size_t address, bool write, std::size_t tick) {
+        Line* line = find(address / config_.lineSize);
+        if (!line) {
+            return std::nullopt;
+        }
+        touch(line);
+        line->dirty |= write;
+        std::size_t done = tick + config_.latency;
+        if (line->prefetched) {
+            line->prefetched = false;
+            StatsLogger::instance().logPrefetchUse(line->readyTick > done);
+        }
+        if (line->readyTick > done) {
+            StatsLogger::instance().logCacheMerge(name_);
+            return line->readyTick;
+        }
+        StatsLogger::instance().logCacheHit(name_);
+        return done;
+    }
+
+    bool Cache::hasFreeMshr(std::size_t tick) {
+        std::erase_if(mshrs_, [tick](std::size_t ready) { return ready <= tick; });
+        std::size_t start = tick + config_.latency;
+        return static_cast<std::size_t>(std::count_if(mshrs_.begin(), mshrs_.end(),
+                                                      [start](std::size_t ready) { return ready > start; })) < config_.mshrCnt;
+    }
+
+    std::size_t Cache::startMiss(std::size_t tick) {
+        std::erase_if(mshrs_, [tick](std::size_t ready) { return ready <= tick; });
+        std::size_t start = tick + config_.latency;
+        // Misses keep their MSHR until the line arrives
+        while (true) {
+            auto busy = std::count_if(mshrs_.begin(), mshrs_.end(), [start](std::size_t ready) { return ready > start; });
+            if (static_cast<std::size_t>(busy) < config_.mshrCnt) {
+                break;
+            }
+            std::size_t next = std::numeric_limits<std::size_t>::max();
+            for (std::size_t ready : mshrs_) {
+                if (ready > start) {
+                    next = std::min(next, ready);
+                }
+            }
+            start = next;
+        }
+        if (start != tick + config_.latency) {
+            StatsLogger::instance().logCacheMshrWait(name_, start - tick - config_.latency);
+        }
+        return start;
+    }
+
+    std::optional<std::size_t> Cache::fill(std::size_t address, bool write, std::size_t tick, std::size_t readyTick, bool prefetch) {
+        mshrs_.push_back(readyTick);
+        if (!prefetch) {
+            StatsLogger::instance().logCacheMiss(name_, readyTick - tick);
+        }
+        auto evicted = install(address / config_.lineSize, write, readyTick);
+        find(address / config_.lineSize)->prefetched = prefetch;
+        return evicted;
+    }
+
+    std::optional<std::size_t> Cache::writeBack(std::size_t address, std::size_t tick) {
+        std::size_t line = address / config_.lineSize;
+        if (Line* present = find(line)) {
+            present->dirty = true;
+            touch(present);
+            return std::nullopt;
+        }
+        // The whole line is written, so nothing needs to be fetched
+        return install(line, true, tick);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <optional>
+#include <cstdint>
+
+namespace tiny::t86 {
+    /**
+     * Timing model of a data cache, only tags are kept, values always live in the ram.
+     * Set associative with write-back and write-allocate, a line is replaced by LRU or by a tree pseudo-LRU.
+     * Misses are non-blocking, each outstanding miss holds a miss status holding register (MSHR) until its line arrives,
+     * accesses to a line that is still arriving wait for it instead of missing again.
+     */
+    class Cache {
+    public:
+        enum class Replacement {
+            Lru, PseudoLru
+        };
+
+        struct Config {
+            std::size_t sets;
+            std::size_t ways;
+            // In words
+            std::size_t lineSize;
+            // Ticks of a hit, misses pay it too before going to the next level
+            std::size_t latency;
+            std::size_t mshrCnt;
+            Replacement replacement;
+        };
+
+        /// Either lru or plru
+        static Replacement parseReplacement(const std::string& name);
+
+        Cache(std::string name, const Config& config);
+
+        const std::string& name() const {
+            return name_;
+        }
+
+        /// If the line is present, returns the tick in which the access is done, that is later than the hit latency if the line still arrives
+        std::optional<std::size_t> lookup(std::size_t address, bool write, std::size_t tick);
+
+        /// Tick in which a miss found in the given tick goes to the next level, it waits for a free MSHR
+        std::size_t startMiss(std::size_t tick);
+
+        /// Puts in the line of a miss that arrives in readyTick, returns the address of an evicted dirty line to write back
+        /// A prefetched line is not counted as a miss, its first access tells whether the prefetch was useful
+        std::optional<std::size_t> fill(std::size_t address, bool write, std::size_t tick, std::size_t readyTick, bool prefetch = false);
+
+        bool contains(std::size_t address) const;
+
+        /// Whether a miss found in the given tick would not have to wait for an MSHR
+        bool hasFreeMshr(std::size_t tick);
+
+        /// Dirty line evicted from the level above, returns the address of a line this level evicts in turn
+        std::optional<std::size_t> writeBack(std::size_t address, std::size_t tick);
+
+    private:
+        struct Line {
+            bool valid{false};
+            bool dirty{false};
+            // Brought in by a prefetch and not accessed since
+            bool prefetched{false};
+            std::size_t tag{0};
+            // Tick from which the data of the line is here
+            std::size_t readyTick{0};
+            std::size_t lastUse{0};
+        };
+
+        Line* find(std::size_t line);
+
+        void touch(Line* line);
+
+        /// Replaces a line of the set, returns the address of the evicted line if it was dirty
+        std::optional<std::size_t> install(std::size_t line, bool dirty, std::size_t readyTick);
+
+        std::string name_;
+
+        Config config_;
+
+        // Ways of a set are next to each other
+        std::vector<Line> lines_;
+
+        std::size_t useCounter_{0};
+
+        // Tree of each set for the pseudo-LRU, a node points to the half that was not used last
+        std::vector<bool> plruBits_;
+
+        // Ticks in which the outstanding misses arrive
+        std::vector<std::size_t> mshrs_;
+    };
+}
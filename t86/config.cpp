@@ -5,11 +5,11 @@
 namespace tiny::t86 {
 
     std::size_t RAM::readLatency(std::size_t) const {
-        return 5;
+        return readLatency_;
     }
 
     std::size_t RAM::writeLatency(std::size_t) const {
-        return 5;
+        return writeLatency_;
     }
 
     std::size_t MOV::length() const {
@@ -251,4 +251,8 @@ namespace tiny::t86 {
         return 1;
     }
 
+    std::size_t PREFETCH::length() const {
+        return 1;
+    }
+
 }
\ No newline at end of file
@@ -1,10 +1,16 @@
 #include <functional>
 #include <utility>
 #include <cassert>
+#include <fstream>
 
 #include "cpu.h"
 #include "utils/stats_logger.h"
 #include "cpu/branch_predictors/naive_branch_predictor.h"
+#include "cpu/branch_predictors/bimodal_branch_predictor.h"
+#include "cpu/branch_predictors/gshare_branch_predictor.h"
+#include "cpu/branch_predictors/tage_branch_predictor.h"
+#include "cpu/functional_context.h"
+#include "cpu/prefetchers/stride_prefetcher.h"
 #include "../common/config.h"
 
 namespace tiny::t86 {
@@ -13,7 +19,7 @@ namespace tiny::t86 {
 
         ram_.tick();
 
-        writesManager_.removeFinished(ram_);
+        storeQueue_.removeFinished(ram_);
 
         reservationStation_.executeAndRetire();
 
@@ -23,41 +29,109 @@ namespace tiny::t86 {
 
         reservationStation_.fetchAndStartExecution();
 
-        if (instructionDecode_) {
-            if (reservationStation_.hasFreeEntry()) {
-                reservationStation_.add(instructionDecode_->instruction, instructionDecode_->pc, instructionDecode_->loggingId);
-                instructionDecode_ = std::nullopt;
+        bool frontEndActive = false;
+        // Dispatch is in program order, it stops at the first instruction that does not fit
+        for (std::size_t i = 0; i < dispatchWidth_ && !decodeQueue_.empty() && reservationStation_.hasFreeEntry(); ++i) {
+            const auto& next = decodeQueue_.front();
+            if (!registerAllocator_.hasFree(next.decoded->renamesCount)) {
+                StatsLogger::instance().logRegisterPressureStall();
+                break;
             }
+            reservationStation_.add(*next.decoded, next.pc, next.loggingId, next.prediction);
+            decodeQueue_.pop_front();
+            frontEndActive = true;
         }
+        StatsLogger::instance().logPhysicalRegisters(registerAllocator_.inUse(), registerAllocator_.size());
 
-        if (!instructionDecode_) {
-            // this will set instructionFetch to be nullopt
-            std::swap(instructionDecode_, instructionFetch_);
+        while (decodeQueue_.size() < decodeWidth_ && !fetchQueue_.empty()) {
+            decodeQueue_.push_back(fetchQueue_.front());
+            fetchQueue_.pop_front();
+            frontEndActive = true;
         }
 
-        if (!instructionFetch_) {
-            instructionFetch_ = fetchInstruction();
+        for (std::size_t i = 0; i < fetchWidth_ && fetchQueue_.size() < fetchQueueSize_; ++i) {
+            const auto& fetched = fetchQueue_.emplace_back(fetchInstruction());
+            frontEndActive = true;
+            // Instructions after a taken jump would come from another line
+            if (speculativeProgramCounter_ != fetched.pc) {
+                break;
+            }
+        }
+
+        for (const auto& entry : fetchQueue_) {
+            StatsLogger::instance().logInstructionFetch(entry.loggingId);
+        }
+        for (const auto& entry : decodeQueue_) {
+            StatsLogger::instance().logInstructionDecode(entry.loggingId);
         }
 
-        if (instructionFetch_) {
-            StatsLogger::instance().logInstructionFetch(instructionFetch_->loggingId);
+        if (fastForward_ && !frontEndActive && !ram_.active() && !reservationStation_.active()) {
+            fastForward();
+        }
+    }
+
+    void Cpu::fastForward() {
+        // Nothing changed in this tick, so every following tick is the same until ram or an alu finishes something
+        auto nextEvent = std::min(ram_.nextEventTick(), reservationStation_.nextEventTick(),
+                                  [](const auto& a, const auto& b) { return a && (!b || *a < *b); });
+        if (!nextEvent) {
+            return;
+        }
+        std::size_t now = reservationStation_.currentTick();
+        assert(ram_.currentTick() == now);
+        if (*nextEvent <= now + 1) {
+            return;
+        }
+        std::size_t skipped = *nextEvent - now - 1;
+        ram_.skip(skipped);
+        reservationStation_.skip(skipped);
+        StatsLogger::instance().repeatTick(skipped);
+    }
+
+    void Cpu::step() {
+        bool logging = StatsLogger::instance().loggingEnabled();
+        std::size_t loggingId = 0;
+        if (logging) {
+            std::size_t pc = architecturalRegister(Register::ProgramCounter());
+            StatsLogger::instance().newTick();
+            loggingId = StatsLogger::instance().registerNewInstruction(pc, decodedProgram_.at(pc).instruction);
         }
-        if (instructionDecode_) {
-            StatsLogger::instance().logInstructionDecode(instructionDecode_->loggingId);
+        functionalInterpreter_.step();
+        if (logging) {
+            StatsLogger::instance().finishInstruction(loggingId);
         }
     }
 
     Cpu::InstructionEntry Cpu::fetchInstruction() {
         std::size_t oldPc = speculativeProgramCounter_;
-        const auto* instruction = program_.at(speculativeProgramCounter_);
-        if (auto jumpInstruction = dynamic_cast<const JumpInstruction*>(instruction); jumpInstruction) {
-            speculativeProgramCounter_ = branchPredictor_->nextGuess(speculativeProgramCounter_, *jumpInstruction);
-            predictions_.push_back(speculativeProgramCounter_);
+        const auto& decoded = decodedProgram_.at(speculativeProgramCounter_);
+        JumpPrediction prediction;
+        if (decoded.jump) {
+            prediction.predictorCheckpoint = branchPredictor_->checkpoint();
+            prediction.returnAddressStackCheckpoint = returnAddressStack_.checkpoint();
+            std::optional<uint64_t> target;
+            Operand destination = decoded.jump->getDestination();
+            if (destination.isFetched()) {
+                target = destination.getValue();
+            } else if (decoded.type == Instruction::Type::RET && returnAddressStack_.capacity()) {
+                target = returnAddressStack_.pop();
+                prediction.targetFromRas = target.has_value();
+            }
+            if (!target && branchTargetBuffer_.enabled()) {
+                target = branchTargetBuffer_.lookup(oldPc);
+                prediction.targetFromBtb = target.has_value();
+                prediction.btbMiss = !target;
+            }
+            if (decoded.type == Instruction::Type::CALL) {
+                returnAddressStack_.push(oldPc + 1);
+            }
+            speculativeProgramCounter_ = branchPredictor_->nextGuess(speculativeProgramCounter_, *decoded.jump, target);
+            prediction.destination = speculativeProgramCounter_;
         }
         else {
             ++speculativeProgramCounter_;
         }
-        return {instruction, oldPc + 1, StatsLogger::instance().registerNewInstruction(oldPc, instruction)};
+        return {&decoded, oldPc + 1, StatsLogger::instance().registerNewInstruction(oldPc, decoded.instruction), prediction};
     }
 
     int64_t Cpu::getRegister(Register reg) const {
@@ -94,15 +168,56 @@ namespace tiny::t86 {
 
     Cpu::Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt, std::size_t reservationStationEntriesCount,
         std::size_t ramSize, std::size_t ramGatesCnt)
-            : reservationStation_(*this, aluCnt, reservationStationEntriesCount),
-              branchPredictor_{std::make_unique<NaiveBranchPredictor>()},
+            : Cpu(registerCount,
+                floatRegisterCount,
+                aluCnt,
+                reservationStationEntriesCount,
+                ramSize,
+                ramGatesCnt,
+                Config::instance().physicalRegisterCnt()) {}
+
+    Cpu::Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt, std::size_t reservationStationEntriesCount,
+        std::size_t ramSize, std::size_t ramGatesCnt, std::size_t physicalRegisterCount)
+            : reservationStation_(*this, createFunctionalUnits(aluCnt), reservationStationEntriesCount, Config::instance().retireWidth()),
+              branchPredictor_{createBranchPredictor(Config::instance().branchPredictor())},
               registerCnt_(registerCount),
               floatRegisterCnt_(floatRegisterCount),
-              physicalRegisterCnt_(specialRegistersCnt + registerCount + floatRegisterCount + reservationStationEntriesCount * possibleRenamedRegisterCnt),
+              physicalRegisterCnt_(physicalRegisterCount ? physicalRegisterCount
+                  : specialRegistersCnt + registerCount + floatRegisterCount + reservationStationEntriesCount * possibleRenamedRegisterCnt),
               registers_(physicalRegisterCnt_),
-              rat_(*this, registerCount, floatRegisterCount),
-              ram_(ramSize, ramGatesCnt)
+              rat_(registerCount, floatRegisterCount),
+              registerAllocator_(physicalRegisterCnt_, rat_),
+              ram_(ramSize, ramGatesCnt, Config::instance().ramReadLatency(), Config::instance().ramWriteLatency()),
+              prefetcher_{createPrefetcher(Config::instance().prefetcher())},
+              fastForward_(Config::instance().fastForward()),
+              speculativeLoads_(Config::instance().speculativeLoads()),
+              returnAddressStack_(Config::instance().returnAddressStackSize()),
+              retiredReturnAddressStack_(returnAddressStack_),
+              branchTargetBuffer_(Config::instance().btbSets(), Config::instance().btbWays()),
+              resolveBranchesAtExecute_(Config::instance().resolveBranchesAtExecute()),
+              fetchWidth_(Config::instance().fetchWidth()),
+              decodeWidth_(Config::instance().decodeWidth()),
+              dispatchWidth_(Config::instance().dispatchWidth()),
+              fetchQueueSize_(Config::instance().fetchQueueSize() ? Config::instance().fetchQueueSize() : fetchWidth_)
     {
+        if (!fetchWidth_ || !decodeWidth_ || !dispatchWidth_) {
+            throw std::runtime_error("Fetch, decode and dispatch widths must be at least 1");
+        }
+        if (auto banks = Config::instance().ramBanks()) {
+            ram_.setBanks(*banks);
+        }
+        ram_.setPorts(Config::instance().ramReadPorts(), Config::instance().ramWritePorts());
+        ram_.setPrefetchBufferSize(Config::instance().prefetchBufferSize());
+        for (const char* cache : Config::cacheNames) {
+            if (auto cacheConfig = Config::instance().cache(cache)) {
+                ram_.addCache(cache, *cacheConfig);
+            }
+        }
+        // Otherwise a single instruction might never get renamed
+        if (registerAllocator_.freeCount() < possibleRenamedRegisterCnt) {
+            throw std::runtime_error(utils::format("Physical register count is too small, at least {} are needed",
+                                                   physicalRegisterCnt_ - registerAllocator_.freeCount() + possibleRenamedRegisterCnt));
+        }
         // Clearing of the registers is not required per se, but we need to mark them as available, which setRegister does.
         for (std::size_t i = 0; i < registerCount; ++i) {
             setRegister(Register{i}, 0);
@@ -127,16 +242,33 @@ namespace tiny::t86 {
 
     void Cpu::setRegister(PhysicalRegister reg, int64_t value) {
         registers_.at(reg.index()).value = value;
+        wakeUpWaiting(reg);
         registers_.at(reg.index()).ready = true;
     }
 
     void Cpu::setRegister(PhysicalRegister reg, double value) {
         registers_.at(reg.index()).value = *reinterpret_cast<int64_t*>(&value); // Store the double as int64_t
+        wakeUpWaiting(reg);
         registers_.at(reg.index()).ready = true;
     }
 
+    void Cpu::waitForRegister(PhysicalRegister reg, ReservationStation::Entry& entry) {
+        assert(!registerReady(reg));
+        registers_.at(reg.index()).waiting.push_back(&entry);
+    }
+
+    void Cpu::wakeUpWaiting(PhysicalRegister reg) {
+        auto& waiting = registers_.at(reg.index()).waiting;
+        for (auto* entry : waiting) {
+            reservationStation_.wakeUp(*entry);
+        }
+        waiting.clear();
+    }
+
     void Cpu::start(Program&& program) {
         program_ = std::move(program);
+        decodedProgram_ = DecodedProgram(program_, reservationStation_.functionalUnits());
+        functionalInterpreter_.load(decodedProgram_);
         const auto& data = program_.data();
         for (std::size_t i = 0; i < data.size(); ++i) {
             setMemory(i, data[i]);
@@ -151,26 +283,61 @@ namespace tiny::t86 {
         halted_ = true;
     }
 
-    std::optional<uint64_t> Cpu::readMemory(uint64_t address, MemoryWrite::Id maxId) {
-        if (writesManager_.hasUnspecifiedWrites(maxId)) {
-            return std::nullopt;
+    std::optional<uint64_t> Cpu::readMemory(uint64_t address, MemoryWrite::Id maxId, ReservationStation::Entry& load) {
+        bool speculative = false;
+        if (storeQueue_.hasUnspecifiedWrites(maxId)) {
+            MemoryWrite::Id dependency = load.storeDependency();
+            if (!speculativeLoads_ || (dependency != 0 && dependency <= maxId && storeQueue_.isUnspecified(dependency))) {
+                return std::nullopt;
+            }
+            speculative = true;
         }
-        auto optWrite = writesManager_.previousWrite(address, maxId);
+        std::optional<uint64_t> value;
+        // The load has its value, or the ram read that took it is on its way
+        bool valueTaken = false;
+        MemoryWrite::Id source = 0;
+        auto optWrite = storeQueue_.previousWrite(address, maxId);
         if (optWrite) {
             // There is a previous write
-            if (optWrite->hasValue()) {
-                // We already know the value
-                return optWrite->value();
+            if (!optWrite->hasValue()) {
+                // We don't know the value yet
+                return std::nullopt;
             }
-            // We don't know the value yet
-            return std::nullopt;
+            // We already know the value
+            value = optWrite->value();
+            source = optWrite->id();
+            valueTaken = true;
+        } else {
+            // We need to read it from mem
+            value = ram_.read(address);
+            valueTaken = value || ram_.reading(address);
+        }
+        if (valueTaken && speculative) {
+            // Own writes of the load are not older than it
+            MemoryWrite::Id olderMaxId = load.memoryWriteIds().empty() ? maxId : load.memoryWriteIds().front() - 1;
+            // Stores resolved before the value arrives must still find the load
+            if (loadQueue_.add({&load, address, olderMaxId, source})) {
+                StatsLogger::instance().logSpeculativeLoad();
+            }
+        }
+        return value;
+    }
+
+    void Cpu::trainPrefetcher(uint64_t pc, uint64_t address) {
+        if (!prefetcher_) {
+            return;
+        }
+        for (uint64_t prefetch : prefetcher_->train(pc, address)) {
+            StatsLogger::instance().logPrefetch(ram_.prefetch(prefetch), false);
         }
-        // We need to read it from mem
-        return ram_.read(address);
+    }
+
+    void Cpu::prefetchMemory(uint64_t address) {
+        StatsLogger::instance().logPrefetch(ram_.prefetch(address), true);
     }
 
     void Cpu::writeMemory(MemoryWrite::Id id) {
-        writesManager_.startWriting(id, ram_);
+        storeQueue_.startWriting(id, ram_);
     }
 
     uint64_t Cpu::getMemory(uint64_t address) const {
@@ -183,28 +350,81 @@ namespace tiny::t86 {
 
     void Cpu::jump(const ReservationStation::Entry& entry, bool taken) {
         uint64_t destination = entry.getUpdatedProgramCounter();
+        const JumpInstruction& instruction = *entry.decoded().jump;
+        // Retired stack is what the speculative one is repaired to
+        if (entry.decoded().type == Instruction::Type::CALL) {
+            retiredReturnAddressStack_.push(entry.pc() + 1);
+        } else if (entry.decoded().type == Instruction::Type::RET) {
+            retiredReturnAddressStack_.pop();
+        }
         if (taken) {
-            registerBranchTaken(entry.getRegister(Register::ProgramCounter()), destination);
+            registerBranchTaken(entry.pc(), instruction, destination);
+            // Only indirect jumps need the buffer
+            if (branchTargetBuffer_.enabled() && !instruction.getDestination().isFetched()) {
+                branchTargetBuffer_.update(entry.pc(), destination);
+            }
         } else {
-            registerBranchNotTaken(entry.getRegister(Register::ProgramCounter()));
+            registerBranchNotTaken(entry.pc(), instruction);
+        }
+        checkBranchPrediction(entry, destination, taken);
+    }
+
+    void Cpu::resolveJump(const ReservationStation::Entry& entry) {
+        if (!resolveBranchesAtExecute_) {
+            return;
+        }
+        uint64_t destination = entry.getUpdatedProgramCounter();
+        if (destination != entry.prediction().destination) {
+            recoverFromMisprediction(entry, destination);
+        }
+    }
+
+    void Cpu::recoverFromMisprediction(const ReservationStation::Entry& jump, uint64_t destination) {
+        std::size_t squashed = reservationStation_.squashYoungerThan(jump);
+        StatsLogger::instance().logBranchRecovery(squashed);
+        // Renames of the squashed entries were released, the rat goes back to the state right after the jump
+        rat_ = jump.ratCheckpoint();
+        storeQueue_.removePendingAfter(jump.maxWriteId());
+        storeSetPredictor_.clearInFlightAfter(jump.maxWriteId());
+
+        const auto& prediction = jump.prediction();
+        branchPredictor_->restore(prediction.predictorCheckpoint, *jump.decoded().jump, jump.jumpTaken());
+        returnAddressStack_.restore(prediction.returnAddressStackCheckpoint);
+        if (jump.decoded().type == Instruction::Type::CALL) {
+            returnAddressStack_.push(jump.pc() + 1);
+        } else if (jump.decoded().type == Instruction::Type::RET) {
+            returnAddressStack_.pop();
         }
-        checkBranchPrediction(entry, destination);
+
+        clearFrontEnd();
+        speculativeProgramCounter_ = destination;
+    }
+
+    const DecodedProgram& Cpu::decodedProgram() const {
+        return decodedProgram_;
     }
 
-    void Cpu::registerBranchTaken(uint64_t sourcePc, uint64_t destination) {
-        branchPredictor_->registerBranchTaken(sourcePc, destination);
+    void Cpu::registerBranchTaken(uint64_t sourcePc, const JumpInstruction& instruction, uint64_t destination) {
+        branchPredictor_->registerBranchTaken(sourcePc, instruction, destination);
     }
 
-    void Cpu::registerBranchNotTaken(uint64_t sourcePc) {
-        branchPredictor_->registerBranchNotTaken(sourcePc);
+    void Cpu::registerBranchNotTaken(uint64_t sourcePc, const JumpInstruction& instruction) {
+        branchPredictor_->registerBranchNotTaken(sourcePc, instruction);
     }
 
-    void Cpu::checkBranchPrediction(const ReservationStation::Entry& entry, uint64_t destination) {
-        assert(!predictions_.empty());
-        std::size_t predictedDestination = predictions_.front();
-        predictions_.pop_front();
-        if (predictedDestination != destination) {
-            unrollSpeculation(entry.rat());
+    void Cpu::checkBranchPrediction(const ReservationStation::Entry& entry, uint64_t destination, bool taken) {
+        const auto& prediction = entry.prediction();
+        uint64_t predictedDestination = prediction.destination;
+        if ((prediction.targetFromBtb || prediction.btbMiss) && taken) {
+            StatsLogger::instance().logBranchTargetPrediction(entry.pc(), prediction.targetFromBtb && predictedDestination == destination);
+        }
+        StatsLogger::instance().logBranchPrediction(predictedDestination == destination);
+        if (prediction.targetFromRas) {
+            StatsLogger::instance().logReturnPrediction(predictedDestination == destination);
+        }
+        // Otherwise it was already repaired when the jump executed
+        if (predictedDestination != destination && !resolveBranchesAtExecute_) {
+            unrollSpeculation();
         }
     }
 
@@ -214,9 +434,45 @@ namespace tiny::t86 {
 
     void Cpu::setReady(PhysicalRegister reg) {
         assert(!registerReady(reg));
+        wakeUpWaiting(reg);
         registers_.at(reg.index()).ready = true;
     }
 
+    std::unique_ptr<BranchPredictor> Cpu::createBranchPredictor(const std::string& name) {
+        if (name == "naive") {
+            return std::make_unique<NaiveBranchPredictor>();
+        } else if (name == "bimodal") {
+            return std::make_unique<BimodalBranchPredictor>();
+        } else if (name == "gshare") {
+            return std::make_unique<GshareBranchPredictor>();
+        } else if (name == "tage") {
+            return std::make_unique<TageBranchPredictor>();
+        }
+        throw std::runtime_error(utils::format("Unknown branch predictor {}, use naive, bimodal, gshare or tage", name));
+    }
+
+    std::unique_ptr<Prefetcher> Cpu::createPrefetcher(const std::string& name) {
+        if (name == "none") {
+            return nullptr;
+        } else if (name == "stride") {
+            return std::make_unique<StridePrefetcher>(Config::instance().prefetchTableSize(),
+                                                      Config::instance().prefetchDegree(),
+                                                      Config::instance().prefetchDistance());
+        }
+        throw std::runtime_error(utils::format("Unknown prefetcher {}, use none or stride", name));
+    }
+
+    FunctionalUnits Cpu::createFunctionalUnits(std::size_t aluCnt) {
+        if (!Config::instance().functionalUnits()) {
+            return FunctionalUnits(aluCnt);
+        }
+        std::array<FunctionalUnits::PoolConfig, FunctionalUnits::kindCnt> pools;
+        for (std::size_t i = 0; i < pools.size(); ++i) {
+            pools[i] = Config::instance().functionalUnitPool(static_cast<FunctionalUnits::Kind>(i), aluCnt);
+        }
+        return FunctionalUnits(pools);
+    }
+
     void Cpu::connectBreakHandler(std::function<void(Cpu&)> handler) {
         breakHandler_ = std::move(handler);
     }
@@ -231,98 +487,133 @@ namespace tiny::t86 {
         return rat_;
     }
 
-    void Cpu::subscribeRegisterRead(PhysicalRegister reg) {
-        ++(registers_.at(reg.index()).subscribedReads);
+    RegisterAllocationTable::Rename Cpu::renameRegister(Register reg) {
+        return rename(rat_.index(reg));
     }
 
-    void Cpu::unsubscribeRegisterRead(PhysicalRegister reg) {
-        assert(registers_.at(reg.index()).subscribedReads);
-        --(registers_.at(reg.index()).subscribedReads);
+    RegisterAllocationTable::Rename Cpu::renameFloatRegister(FloatRegister fReg) {
+        return rename(rat_.index(fReg));
     }
 
-    void Cpu::renameRegister(Register reg) {
-        PhysicalRegister dest = nextFreeRegister();
-        rat_.rename(reg, dest);
+    RegisterAllocationTable::Rename Cpu::rename(std::size_t logical) {
+        PhysicalRegister dest = registerAllocator_.allocate();
         registers_.at(dest.index()).ready = false;
+        // Whoever waited for the previous value was squashed
+        registers_.at(dest.index()).waiting.clear();
+        // The previous register keeps its reference until the rename retires
+        return {logical, dest, rat_.rename(logical, dest)};
     }
 
-    void Cpu::renameFloatRegister(FloatRegister fReg) {
-        PhysicalRegister dest = nextFreeRegister();
-        rat_.rename(fReg, dest);
-        registers_.at(dest.index()).ready = false;
+    void Cpu::retireRename(const RegisterAllocationTable::Rename& rename) {
+        registerAllocator_.release(rename.previous);
     }
 
-    PhysicalRegister Cpu::nextFreeRegister() const {
-        for (std::size_t i = 0; i < physicalRegisterCnt_; ++i) {
-            if (rat_.isUnmapped(PhysicalRegister{i}) && registers_.at(i).subscribedReads == 0) {
-                return i;
-            }
-        }
-        throw std::runtime_error("No free register was found, either bug in RAT or small scale for physical registers");
+    void Cpu::undoRename(const RegisterAllocationTable::Rename& rename) {
+        assert(rat_.translate(rename.logical) == rename.current);
+        rat_.rename(rename.logical, rename.previous);
+        registerAllocator_.release(rename.current);
+    }
+
+    void Cpu::releaseRename(const RegisterAllocationTable::Rename& rename) {
+        registerAllocator_.release(rename.current);
     }
 
     void Cpu::flushPipeline() {
         // Unroll speculation
         reservationStation_.clear();
-        predictions_.clear();
-        if (instructionFetch_) {
-            StatsLogger::instance().logClearSpeculation(instructionFetch_->loggingId);
-            instructionFetch_ = std::nullopt;
+        loadQueue_.clear();
+        storeSetPredictor_.clearInFlight();
+        branchPredictor_->squash();
+        returnAddressStack_ = retiredReturnAddressStack_;
+        clearFrontEnd();
+    }
+
+    void Cpu::clearFrontEnd() {
+        for (const auto& entry : fetchQueue_) {
+            StatsLogger::instance().logClearSpeculation(entry.loggingId);
         }
-        if (instructionDecode_) {
-            StatsLogger::instance().logClearSpeculation(instructionDecode_->loggingId);
-            instructionDecode_ = std::nullopt;
+        for (const auto& entry : decodeQueue_) {
+            StatsLogger::instance().logClearSpeculation(entry.loggingId);
         }
+        fetchQueue_.clear();
+        decodeQueue_.clear();
     }
 
     void Cpu::dumpState(std::ostream& os) const {
-        auto printInstructionEntry = [&](const std::optional<InstructionEntry>& entry) {
-            if (entry) {
-                utils::output(os, "{} at {}", entry->instruction->toString(), entry->pc);
-            } else {
+        auto printInstructionEntries = [&](const std::deque<InstructionEntry>& entries) {
+            if (entries.empty()) {
                 utils::output(os, "<none>");
             }
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                utils::output(os, "{}{} at {}", i ? ", " : "", entries[i].decoded->instruction->toString(), entries[i].pc);
+            }
         };
 
         utils::output(os, "Instruction being fetched: ");
-        printInstructionEntry(instructionFetch_);
+        printInstructionEntries(fetchQueue_);
         os << std::endl;
 
         utils::output(os, "Instruction being decoded: ");
-        printInstructionEntry(instructionDecode_);
+        printInstructionEntries(decodeQueue_);
         os << std::endl;
     }
 
-    void Cpu::unrollSpeculation(const RegisterAllocationTable& rat) {
+    void Cpu::unrollSpeculation() {
+        // Restores the rat as well, by undoing renames of the thrown away instructions
         flushPipeline();
-        // Restore rat
-        rat_ = rat;
 
         // Set correct PC
         speculativeProgramCounter_ = getRegister(Register::ProgramCounter());
 
         // Remove pending writes
-        writesManager_.removePending();
+        storeQueue_.removePending();
     }
 
-    MemoryWrite::Id Cpu::registerPendingWrite(Memory::Immediate mem) {
-        return writesManager_.registerPendingWrite(mem.index());
+    MemoryWrite::Id Cpu::registerPendingWrite(std::size_t storePc, Memory::Immediate mem) {
+        MemoryWrite::Id id = storeQueue_.registerPendingWrite(mem.index());
+        storeSetPredictor_.storeDispatched(storePc, id);
+        return id;
     }
 
-    MemoryWrite::Id Cpu::registerPendingWrite() {
-        return writesManager_.registerPendingWrite();
+    MemoryWrite::Id Cpu::registerPendingWrite(std::size_t storePc) {
+        MemoryWrite::Id id = storeQueue_.registerPendingWrite();
+        storeSetPredictor_.storeDispatched(storePc, id);
+        return id;
     }
 
     MemoryWrite& Cpu::getWrite(MemoryWrite::Id id) {
-        return writesManager_.getWrite(id);
+        return storeQueue_.getWrite(id);
     }
 
     MemoryWrite::Id Cpu::currentMaxWriteId() const {
-        return writesManager_.currentMaxWriteId();
+        return storeQueue_.currentMaxWriteId();
+    }
+
+    void Cpu::specifyWriteAddress(MemoryWrite::Id id, uint64_t address, std::size_t storePc) {
+        storeQueue_.specifyAddress(id, address);
+        loadQueue_.forEachViolation(id, address, [&](const LoadQueue::Load& load) {
+            if (!load.entry->memoryOrderViolated()) {
+                load.entry->violateMemoryOrder();
+                StatsLogger::instance().logMemoryOrderViolation();
+            }
+            storeSetPredictor_.violation(load.entry->pc(), storePc);
+        });
+    }
+
+    MemoryWrite::Id Cpu::predictStoreDependency(std::size_t loadPc) const {
+        return storeSetPredictor_.predict(loadPc);
     }
 
-    void Cpu::specifyWriteAddress(MemoryWrite::Id id, uint64_t value) {
-        writesManager_.specifyAddress(id, value);
+    void Cpu::removeLoad(const ReservationStation::Entry& load) {
+        if (!loadQueue_.empty()) {
+            loadQueue_.remove(load);
+        }
+    }
+
+    void Cpu::replayLoad() {
+        StatsLogger::instance().logLoadReplay();
+        // The load's renames are undone too, so the pc points to it again
+        unrollSpeculation();
     }
 
     std::size_t Cpu::Config::registerCnt() const {
@@ -349,31 +640,337 @@ namespace tiny::t86 {
         return std::stoul(config.get(ramGatesCountConfigString));
     }
 
+    std::size_t Cpu::Config::ramReadLatency() const {
+        return std::stoul(config.get(ramReadLatencyConfigString));
+    }
+
+    std::size_t Cpu::Config::ramWriteLatency() const {
+        return std::stoul(config.get(ramWriteLatencyConfigString));
+    }
+
+    std::optional<RAM::BankConfig> Cpu::Config::ramBanks() const {
+        RAM::BankConfig banks{};
+        banks.banks = std::stoul(config.get(ramBanksConfigString));
+        if (banks.banks == 0) {
+            return std::nullopt;
+        }
+        banks.interleave = std::stoul(config.get(ramInterleaveConfigString));
+        banks.rowSize = std::stoul(config.get(ramRowSizeConfigString));
+        banks.activateLatency = std::stoul(config.get(ramActivateLatencyConfigString));
+        banks.prechargeLatency = std::stoul(config.get(ramPrechargeLatencyConfigString));
+        return banks;
+    }
+
+    std::string Cpu::Config::prefetcher() const {
+        return config.get(prefetcherConfigString);
+    }
+
+    std::size_t Cpu::Config::prefetchTableSize() const {
+        return std::stoul(config.get(prefetchTableSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::prefetchDegree() const {
+        return std::stoul(config.get(prefetchDegreeConfigString));
+    }
+
+    std::size_t Cpu::Config::prefetchDistance() const {
+        return std::stoul(config.get(prefetchDistanceConfigString));
+    }
+
+    std::size_t Cpu::Config::prefetchBufferSize() const {
+        return std::stoul(config.get(prefetchBufferSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::ramReadPorts() const {
+        return std::stoul(config.get(ramReadPortsConfigString));
+    }
+
+    std::size_t Cpu::Config::ramWritePorts() const {
+        return std::stoul(config.get(ramWritePortsConfigString));
+    }
+
+    std::size_t Cpu::Config::physicalRegisterCnt() const {
+        return std::stoul(config.get(physicalRegisterCountConfigString));
+    }
+
+    bool Cpu::Config::fastForward() const {
+        return std::stoul(config.get(fastForwardConfigString)) != 0;
+    }
+
+    std::size_t Cpu::Config::returnAddressStackSize() const {
+        return std::stoul(config.get(returnAddressStackSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::btbSets() const {
+        return std::stoul(config.get(btbSetsConfigString));
+    }
+
+    std::size_t Cpu::Config::btbWays() const {
+        return std::stoul(config.get(btbWaysConfigString));
+    }
+
+    bool Cpu::Config::resolveBranchesAtExecute() const {
+        return std::stoul(config.get(resolveBranchesAtExecuteConfigString)) != 0;
+    }
+
+    std::size_t Cpu::Config::fetchWidth() const {
+        return std::stoul(config.get(fetchWidthConfigString));
+    }
+
+    std::size_t Cpu::Config::decodeWidth() const {
+        return std::stoul(config.get(decodeWidthConfigString));
+    }
+
+    std::size_t Cpu::Config::dispatchWidth() const {
+        return std::stoul(config.get(dispatchWidthConfigString));
+    }
+
+    std::size_t Cpu::Config::fetchQueueSize() const {
+        return std::stoul(config.get(fetchQueueSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::retireWidth() const {
+        return std::stoul(config.get(retireWidthConfigString));
+    }
+
+    bool Cpu::Config::functionalUnits() const {
+        return std::stoul(config.get(functionalUnitsConfigString)) != 0;
+    }
+
+    FunctionalUnits::PoolConfig Cpu::Config::functionalUnitPool(FunctionalUnits::Kind kind, std::size_t aluCnt) const {
+        std::string name = std::string("-") + FunctionalUnits::kindName(kind);
+        FunctionalUnits::PoolConfig pool{};
+        pool.count = std::stoul(config.get(name + "Units"));
+        pool.latency = std::stoul(config.get(name + "Latency"));
+        pool.issueInterval = std::stoul(config.get(name + "IssueInterval"));
+        // Integer alus default to the alu count
+        if (kind == FunctionalUnits::Kind::IntegerAlu && pool.count == 0) {
+            pool.count = aluCnt;
+        }
+        return pool;
+    }
+
+    std::optional<Cache::Config> Cpu::Config::cache(const std::string& name) const {
+        std::string prefix = "-" + name;
+        Cache::Config cache{};
+        cache.sets = std::stoul(config.get(prefix + "Sets"));
+        if (cache.sets == 0) {
+            return std::nullopt;
+        }
+        cache.ways = std::stoul(config.get(prefix + "Ways"));
+        cache.lineSize = std::stoul(config.get(prefix + "LineSize"));
+        cache.latency = std::stoul(config.get(prefix + "Latency"));
+        cache.mshrCnt = std::stoul(config.get(prefix + "Mshrs"));
+        cache.replacement = Cache::parseReplacement(config.get(prefix + "Replacement"));
+        return cache;
+    }
+
+    std::string Cpu::Config::branchPredictor() const {
+        return config.get(branchPredictorConfigString);
+    }
+
+    bool Cpu::Config::speculativeLoads() const {
+        return std::stoul(config.get(speculativeLoadsConfigString)) != 0;
+    }
+
     std::size_t Cpu::Config::getExecutionLength(const Instruction* ins) const {
-        static std::map<Instruction::Signature, std::size_t> lengths = {
-            { { Instruction::Type::MOV, { Operand::Type::Reg, Operand::Type::Imm } }, 2 },
+        Instruction::Signature signature = ins->getSignature();
+        if (auto it = signatureLatencies_.find(signature); it != signatureLatencies_.end()) {
+            return it->second;
+        }
+        if (auto it = typeLatencies_.find(signature.type); it != typeLatencies_.end()) {
+            return it->second;
+        }
+        return std::stoul(config.get(defaultLatencyConfigString));
+    }
+
+    std::vector<std::pair<std::string, std::string>> Cpu::Config::loadMachine(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error(utils::format("Cannot open the machine file {}", path));
+        }
+        auto trim = [](const std::string& s) {
+            auto begin = s.find_first_not_of(" \t\r");
+            auto end = s.find_last_not_of(" \t\r");
+            return begin == std::string::npos ? std::string{} : s.substr(begin, end - begin + 1);
         };
+        std::map<std::string, Instruction::Type> types;
+        for (int t = static_cast<int>(Instruction::Type::MOV); t <= static_cast<int>(Instruction::lastType); ++t) {
+            types.emplace(Instruction::typeToString(static_cast<Instruction::Type>(t)), static_cast<Instruction::Type>(t));
+        }
+        std::map<std::string, Operand::Type> operandTypes;
+        for (int t = static_cast<int>(Operand::Type::Imm); t <= static_cast<int>(Operand::lastType); ++t) {
+            operandTypes.emplace(Operand::typeToString(static_cast<Operand::Type>(t)), static_cast<Operand::Type>(t));
+        }
 
-        if (auto it = lengths.find(ins->getSignature()); it != lengths.end()) {
-            return it->second;
-        } else {
-            // DEFAULT VALUE
-            return 3;
+        std::vector<std::pair<std::string, std::string>> options;
+        std::string line;
+        for (std::size_t lineNumber = 1; std::getline(file, line); ++lineNumber) {
+            auto invalid = [&](const std::string& what) {
+                return std::runtime_error(utils::format("{} on line {} of the machine file {}", what, lineNumber, path));
+            };
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty()) {
+                continue;
+            }
+            auto split = line.find('=');
+            if (split == std::string::npos) {
+                throw invalid("Expected name = value");
+            }
+            std::string name = trim(line.substr(0, split));
+            std::string value = trim(line.substr(split + 1));
+            if (!name.starts_with("latency ")) {
+                options.emplace_back("-" + name, value);
+                continue;
+            }
+            // latency TYPE = N, or latency TYPE OPERAND, OPERAND = N written as in Signature::toString
+            std::size_t latency;
+            try {
+                latency = std::stoul(value);
+            } catch (const std::exception&) {
+                throw invalid("Expected a number of ticks");
+            }
+            std::string signature = trim(name.substr(std::string("latency ").size()));
+            auto typeEnd = signature.find(' ');
+            auto type = types.find(signature.substr(0, typeEnd));
+            if (type == types.end()) {
+                throw invalid("Unknown instruction");
+            }
+            if (typeEnd == std::string::npos) {
+                typeLatencies_[type->second] = latency;
+                continue;
+            }
+            Instruction::Signature key{type->second, {}};
+            std::string operands = signature.substr(typeEnd + 1);
+            for (std::size_t begin = 0; begin <= operands.size();) {
+                auto end = std::min(operands.find(',', begin), operands.size());
+                auto operand = operandTypes.find(trim(operands.substr(begin, end - begin)));
+                if (operand == operandTypes.end()) {
+                    throw invalid("Unknown operand type");
+                }
+                key.operandTypes.push_back(operand->second);
+                begin = end + 1;
+            }
+            signatureLatencies_[key] = latency;
         }
+        return options;
     }
 
     Cpu::Config::Config() {
-        config.setDefaultIfMissing(Config::registerCountConfigString,
-                                   std::to_string(Config::defaultRegisterCount));
-        config.setDefaultIfMissing(Config::floatRegisterCountConfigString,
-                                   std::to_string(Config::defaultFloatRegisterCount));
-        config.setDefaultIfMissing(Config::aluCountConfigString,
-                                   std::to_string(Config::defaultAluCount));
-        config.setDefaultIfMissing(Config::reservationStationEntriesCountConfigString,
-                                   std::to_string(Config::defaultReservationStationEntriesCount));
-        config.setDefaultIfMissing(Config::ramSizeConfigString,
-                                   std::to_string(Config::defaultRamSize));
-        config.setDefaultIfMissing(Config::ramGatesCountConfigString,
-                                   std::to_string(Config::defaultRamGatesCount));
+        std::vector<std::pair<std::string, std::string>> machineOptions;
+        config.setDefaultIfMissing(Config::machineConfigString, "");
+        if (const auto& machine = config.get(Config::machineConfigString); !machine.empty()) {
+            machineOptions = loadMachine(machine);
+        }
+        // Built in latencies are only defaults, the machine file may set the signature or the whole type
+        for (const auto& [signature, latency] : defaultSignatureLatencies) {
+            if (!typeLatencies_.contains(signature.type)) {
+                signatureLatencies_.emplace(signature, latency);
+            }
+        }
+        // Command line wins, so these are only defaults
+        for (const auto& [name, value] : machineOptions) {
+            config.setDefaultIfMissing(name, value);
+        }
+
+        std::set<std::string> known;
+        auto setDefault = [&known](const std::string& name, const std::string& value) {
+            known.insert(name);
+            config.setDefaultIfMissing(name, value);
+        };
+        setDefault(Config::registerCountConfigString,
+                   std::to_string(Config::defaultRegisterCount));
+        setDefault(Config::floatRegisterCountConfigString,
+                   std::to_string(Config::defaultFloatRegisterCount));
+        setDefault(Config::aluCountConfigString,
+                   std::to_string(Config::defaultAluCount));
+        setDefault(Config::reservationStationEntriesCountConfigString,
+                   std::to_string(Config::defaultReservationStationEntriesCount));
+        setDefault(Config::ramSizeConfigString,
+                   std::to_string(Config::defaultRamSize));
+        setDefault(Config::ramGatesCountConfigString,
+                   std::to_string(Config::defaultRamGatesCount));
+        setDefault(Config::ramReadLatencyConfigString,
+                   std::to_string(Config::defaultRamReadLatency));
+        setDefault(Config::ramWriteLatencyConfigString,
+                   std::to_string(Config::defaultRamWriteLatency));
+        setDefault(Config::ramBanksConfigString,
+                   std::to_string(Config::defaultRamBanks));
+        setDefault(Config::ramInterleaveConfigString,
+                   std::to_string(Config::defaultRamInterleave));
+        setDefault(Config::ramRowSizeConfigString,
+                   std::to_string(Config::defaultRamRowSize));
+        setDefault(Config::ramActivateLatencyConfigString,
+                   std::to_string(Config::defaultRamActivateLatency));
+        setDefault(Config::ramPrechargeLatencyConfigString,
+                   std::to_string(Config::defaultRamPrechargeLatency));
+        setDefault(Config::ramReadPortsConfigString,
+                   std::to_string(Config::defaultRamReadPorts));
+        setDefault(Config::ramWritePortsConfigString,
+                   std::to_string(Config::defaultRamWritePorts));
+        setDefault(Config::prefetcherConfigString, Config::defaultPrefetcher);
+        setDefault(Config::prefetchTableSizeConfigString,
+                   std::to_string(Config::defaultPrefetchTableSize));
+        setDefault(Config::prefetchDegreeConfigString,
+                   std::to_string(Config::defaultPrefetchDegree));
+        setDefault(Config::prefetchDistanceConfigString,
+                   std::to_string(Config::defaultPrefetchDistance));
+        setDefault(Config::prefetchBufferSizeConfigString,
+                   std::to_string(Config::defaultPrefetchBufferSize));
+        setDefault(Config::defaultLatencyConfigString,
+                   std::to_string(Config::defaultDefaultLatency));
+        setDefault(Config::physicalRegisterCountConfigString,
+                   std::to_string(Config::defaultPhysicalRegisterCount));
+        setDefault(Config::fastForwardConfigString,
+                   std::to_string(Config::defaultFastForward));
+        setDefault(Config::speculativeLoadsConfigString,
+                   std::to_string(Config::defaultSpeculativeLoads));
+        setDefault(Config::branchPredictorConfigString, Config::defaultBranchPredictor);
+        setDefault(Config::returnAddressStackSizeConfigString,
+                   std::to_string(Config::defaultReturnAddressStackSize));
+        setDefault(Config::btbSetsConfigString,
+                   std::to_string(Config::defaultBtbSets));
+        setDefault(Config::btbWaysConfigString,
+                   std::to_string(Config::defaultBtbWays));
+        setDefault(Config::resolveBranchesAtExecuteConfigString,
+                   std::to_string(Config::defaultResolveBranchesAtExecute));
+        setDefault(Config::fetchWidthConfigString,
+                   std::to_string(Config::defaultFetchWidth));
+        setDefault(Config::decodeWidthConfigString,
+                   std::to_string(Config::defaultDecodeWidth));
+        setDefault(Config::dispatchWidthConfigString,
+                   std::to_string(Config::defaultDispatchWidth));
+        setDefault(Config::fetchQueueSizeConfigString,
+                   std::to_string(Config::defaultFetchQueueSize));
+        setDefault(Config::retireWidthConfigString,
+                   std::to_string(Config::defaultRetireWidth));
+        setDefault(Config::functionalUnitsConfigString,
+                   std::to_string(Config::defaultFunctionalUnits));
+        // Dividers and the float multiplier are iterative, the rest is pipelined
+        for (std::size_t i = 0; i < FunctionalUnits::kindCnt; ++i) {
+            auto kind = static_cast<FunctionalUnits::Kind>(i);
+            std::string name = std::string("-") + FunctionalUnits::kindName(kind);
+            bool iterative = kind == FunctionalUnits::Kind::MulDiv || kind == FunctionalUnits::Kind::FloatMulDiv;
+            setDefault(name + "Units", kind == FunctionalUnits::Kind::IntegerAlu ? "0" : "1");
+            setDefault(name + "Latency", "0");
+            setDefault(name + "IssueInterval", iterative ? "0" : "1");
+        }
+        // Second level is larger and slower
+        for (const char* cache : Config::cacheNames) {
+            std::string name = std::string("-") + cache;
+            bool first = name == "-l1d";
+            setDefault(name + "Sets", "0");
+            setDefault(name + "Ways", first ? "4" : "8");
+            setDefault(name + "LineSize", "8");
+            setDefault(name + "Latency", first ? "1" : "8");
+            setDefault(name + "Mshrs", first ? "4" : "8");
+            setDefault(name + "Replacement", "lru");
+        }
+
+        for (const auto& [name, value] : machineOptions) {
+            if (!known.contains(name)) {
+                throw std::runtime_error(utils::format("Unknown option {} in the machine file", name.substr(1)));
+            }
+        }
     }
 }
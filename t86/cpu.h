@@ -1,16 +1,26 @@
 #pragma once
 
 #include "program.h"
+#include "program/decoded_program.h"
 #include "instruction.h"
 #include "ram.h"
 #include "cpu/register.h"
 #include "cpu/reservation_station.h"
 #include "cpu/register_allocation_table.h"
+#include "cpu/register_allocator.h"
 #include "cpu/branchpredictor.h"
-#include "cpu/memory_writes_manager.h"
+#include "cpu/prefetcher.h"
+#include "cpu/branch_predictors/return_address_stack.h"
+#include "cpu/branch_predictors/branch_target_buffer.h"
+#include "cpu/jump_prediction.h"
+#include "cpu/store_queue.h"
+#include "cpu/load_queue.h"
+#include "cpu/store_set_predictor.h"
+#include "cpu/functional_interpreter.h"
 
 #include <vector>
 #include <list>
+#include <deque>
 #include <variant>
 #include <cstddef>
 #include <array>
@@ -18,6 +28,8 @@
 #include <memory>
 #include <unordered_map>
 #include <set>
+#include <map>
+#include <string>
 
 namespace tiny::t86 {
     class Cpu {
@@ -54,6 +66,149 @@ namespace tiny::t86 {
 
             constexpr static std::size_t defaultRamGatesCount = 4;
 
+            constexpr static const char* ramReadLatencyConfigString = "-ramReadLatency";
+
+            constexpr static std::size_t defaultRamReadLatency = 5;
+
+            constexpr static const char* ramWriteLatencyConfigString = "-ramWriteLatency";
+
+            constexpr static std::size_t defaultRamWriteLatency = 5;
+
+            // Banked ram, 0 banks means every access takes the same time
+            constexpr static const char* ramBanksConfigString = "-ramBanks";
+
+            constexpr static std::size_t defaultRamBanks = 0;
+
+            // Words that go to a bank before the next bank follows
+            constexpr static const char* ramInterleaveConfigString = "-ramInterleave";
+
+            constexpr static std::size_t defaultRamInterleave = 8;
+
+            constexpr static const char* ramRowSizeConfigString = "-ramRowSize";
+
+            constexpr static std::size_t defaultRamRowSize = 64;
+
+            constexpr static const char* ramActivateLatencyConfigString = "-ramActivateLatency";
+
+            constexpr static std::size_t defaultRamActivateLatency = 10;
+
+            constexpr static const char* ramPrechargeLatencyConfigString = "-ramPrechargeLatency";
+
+            constexpr static std::size_t defaultRamPrechargeLatency = 10;
+
+            // Reads and writes started per tick, 0 means no limit
+            constexpr static const char* ramReadPortsConfigString = "-ramReadPorts";
+
+            constexpr static std::size_t defaultRamReadPorts = 0;
+
+            constexpr static const char* ramWritePortsConfigString = "-ramWritePorts";
+
+            constexpr static std::size_t defaultRamWritePorts = 0;
+
+            // Either none or stride, prefetches go into the first cache, or into a prefetch buffer of the ram without caches
+            constexpr static const char* prefetcherConfigString = "-prefetcher";
+
+            constexpr static const char* defaultPrefetcher = "none";
+
+            // Loads tracked by the stride prefetcher
+            constexpr static const char* prefetchTableSizeConfigString = "-prefetchTableSize";
+
+            constexpr static std::size_t defaultPrefetchTableSize = 16;
+
+            // Addresses prefetched at once
+            constexpr static const char* prefetchDegreeConfigString = "-prefetchDegree";
+
+            constexpr static std::size_t defaultPrefetchDegree = 1;
+
+            // Strides between the load and the first prefetched address
+            constexpr static const char* prefetchDistanceConfigString = "-prefetchDistance";
+
+            constexpr static std::size_t defaultPrefetchDistance = 1;
+
+            constexpr static const char* prefetchBufferSizeConfigString = "-prefetchBufferSize";
+
+            constexpr static std::size_t defaultPrefetchBufferSize = 8;
+
+            // Execution length of instructions the machine file does not mention
+            constexpr static const char* defaultLatencyConfigString = "-defaultLatency";
+
+            constexpr static std::size_t defaultDefaultLatency = 3;
+
+            // Machine description file, its options apply unless they are given on the command line
+            constexpr static const char* machineConfigString = "-machine";
+
+            // 0 means enough registers for every reservation station entry to rename all it can
+            constexpr static const char* physicalRegisterCountConfigString = "-physicalRegisterCnt";
+
+            constexpr static std::size_t defaultPhysicalRegisterCount = 0;
+
+            // 0 simulates even the ticks in which nothing can happen
+            constexpr static const char* fastForwardConfigString = "-fastForward";
+
+            constexpr static std::size_t defaultFastForward = 1;
+
+            // Loads may read memory before older stores know their addresses
+            constexpr static const char* speculativeLoadsConfigString = "-speculativeLoads";
+
+            constexpr static std::size_t defaultSpeculativeLoads = 0;
+
+            // One of naive, bimodal, gshare or tage
+            constexpr static const char* branchPredictorConfigString = "-branchPredictor";
+
+            constexpr static const char* defaultBranchPredictor = "naive";
+
+            // 0 means no return address stack
+            constexpr static const char* returnAddressStackSizeConfigString = "-returnAddressStackSize";
+
+            constexpr static std::size_t defaultReturnAddressStackSize = 0;
+
+            // Branch target buffer for indirect jumps, 0 sets means no buffer
+            constexpr static const char* btbSetsConfigString = "-btbSets";
+
+            constexpr static std::size_t defaultBtbSets = 0;
+
+            constexpr static const char* btbWaysConfigString = "-btbWays";
+
+            constexpr static std::size_t defaultBtbWays = 4;
+
+            // Mispredicted jumps squash only younger instructions as soon as they execute, instead of flushing everything on retirement
+            constexpr static const char* resolveBranchesAtExecuteConfigString = "-resolveBranchesAtExecute";
+
+            constexpr static std::size_t defaultResolveBranchesAtExecute = 0;
+
+            // Instructions fetched, decoded and dispatched per tick
+            constexpr static const char* fetchWidthConfigString = "-fetchWidth";
+
+            constexpr static std::size_t defaultFetchWidth = 1;
+
+            constexpr static const char* decodeWidthConfigString = "-decodeWidth";
+
+            constexpr static std::size_t defaultDecodeWidth = 1;
+
+            constexpr static const char* dispatchWidthConfigString = "-dispatchWidth";
+
+            constexpr static std::size_t defaultDispatchWidth = 1;
+
+            // 0 means the same as fetch width
+            constexpr static const char* fetchQueueSizeConfigString = "-fetchQueueSize";
+
+            constexpr static std::size_t defaultFetchQueueSize = 0;
+
+            // Instructions retired per tick, 0 means no limit
+            constexpr static const char* retireWidthConfigString = "-retireWidth";
+
+            constexpr static std::size_t defaultRetireWidth = 0;
+
+            // Typed pools of functional units instead of alus shared by everything
+            // Each pool is configured by -<name>Units, -<name>Latency and -<name>IssueInterval, for names see FunctionalUnits::kindName
+            constexpr static const char* functionalUnitsConfigString = "-functionalUnits";
+
+            constexpr static std::size_t defaultFunctionalUnits = 0;
+
+            // Data caches between the cpu and the ram, from the closest one, 0 sets means the level is left out
+            // Each is configured by -<name>Sets, -<name>Ways, -<name>LineSize, -<name>Latency, -<name>Mshrs and -<name>Replacement
+            constexpr static std::array<const char*, 2> cacheNames = {"l1d", "l2"};
+
             std::size_t registerCnt() const;
 
             std::size_t floatRegisterCnt() const;
@@ -66,10 +221,75 @@ namespace tiny::t86 {
 
             std::size_t ramGatesCount() const;
 
+            std::size_t ramReadLatency() const;
+
+            std::size_t ramWriteLatency() const;
+
+            std::optional<RAM::BankConfig> ramBanks() const;
+
+            std::string prefetcher() const;
+
+            std::size_t prefetchTableSize() const;
+
+            std::size_t prefetchDegree() const;
+
+            std::size_t prefetchDistance() const;
+
+            std::size_t prefetchBufferSize() const;
+
+            std::size_t ramReadPorts() const;
+
+            std::size_t ramWritePorts() const;
+
+            std::size_t physicalRegisterCnt() const;
+
+            bool fastForward() const;
+
+            bool speculativeLoads() const;
+
+            std::string branchPredictor() const;
+
+            std::size_t returnAddressStackSize() const;
+
+            std::size_t btbSets() const;
+
+            std::size_t btbWays() const;
+
+            bool resolveBranchesAtExecute() const;
+
+            std::size_t fetchWidth() const;
+
+            std::size_t decodeWidth() const;
+
+            std::size_t dispatchWidth() const;
+
+            std::size_t fetchQueueSize() const;
+
+            std::size_t retireWidth() const;
+
+            bool functionalUnits() const;
+
+            FunctionalUnits::PoolConfig functionalUnitPool(FunctionalUnits::Kind kind, std::size_t aluCnt) const;
+
+            std::optional<Cache::Config> cache(const std::string& name) const;
+
             std::size_t getExecutionLength(const Instruction* ins) const;
 
         private:
             Config();
+
+            // Latencies are kept here, options are returned to be put into the config
+            std::vector<std::pair<std::string, std::string>> loadMachine(const std::string& path);
+
+            // Latencies of signatures the machine file does not set
+            inline static const std::map<Instruction::Signature, std::size_t> defaultSignatureLatencies = {
+                { { Instruction::Type::MOV, { Operand::Type::Reg, Operand::Type::Imm } }, 2 },
+            };
+
+            // Latencies from the machine file and the defaults, a signature wins over the type
+            std::map<Instruction::Signature, std::size_t> signatureLatencies_;
+
+            std::map<Instruction::Type, std::size_t> typeLatencies_;
         };
 
         // Max instruction operands - for example ADD R1 R2 has 3 (destination and 2 source)
@@ -88,6 +308,8 @@ namespace tiny::t86 {
 
         Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt, std::size_t reservationStationEntriesCount, std::size_t ramSize, std::size_t ramGatesCnt);
 
+        Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt, std::size_t reservationStationEntriesCount, std::size_t ramSize, std::size_t ramGatesCnt, std::size_t physicalRegisterCount);
+
         // These do not include special registers
         std::size_t registersCount() const {
             return registerCnt_;
@@ -103,10 +325,27 @@ namespace tiny::t86 {
 
         void start(Program&& program);
 
+        /**
+         * Simulates one tick. When nothing happened in it, the following ticks up to the next
+         * ram or execution event would be the same, so they are skipped right away.
+         * Stats still count the skipped ticks.
+         */
         void tick();
 
+        /**
+         * Executes the next instruction in order, straight against the architectural state.
+         * This is the functional mode, there is no pipeline and no timing model.
+         * Do not mix with tick() on the same cpu.
+         */
+        void step();
+
         void jump(const ReservationStation::Entry& entry, bool taken);
 
+        /// Jump just executed, when resolving at execute a misprediction is repaired right away
+        void resolveJump(const ReservationStation::Entry& entry);
+
+        const DecodedProgram& decodedProgram() const;
+
         int64_t getRegister(PhysicalRegister reg) const;
 
         double getFloatRegister(PhysicalRegister reg) const;
@@ -117,7 +356,17 @@ namespace tiny::t86 {
 
         MemoryWrite::Id currentMaxWriteId() const;
 
-        std::optional<uint64_t> readMemory(uint64_t address, MemoryWrite::Id maxId);
+        /**
+         * Value of the address as seen by the load, that is after all writes up to maxId.
+         * With speculative loads, the load may skip older writes of unknown address, unless the store set predictor says otherwise.
+         */
+        std::optional<uint64_t> readMemory(uint64_t address, MemoryWrite::Id maxId, ReservationStation::Entry& load);
+
+        /// Load at the pc tried to read the address, the prefetcher may fetch addresses ahead of it
+        void trainPrefetcher(uint64_t pc, uint64_t address);
+
+        /// Prefetch asked for by the program
+        void prefetchMemory(uint64_t address);
 
         MemoryWrite& getWrite(MemoryWrite::Id id);
 
@@ -131,23 +380,41 @@ namespace tiny::t86 {
 
         void setReady(PhysicalRegister reg);
 
-        void renameRegister(Register reg);
+        /// Entry is woken up in the reservation station once the register is ready
+        void waitForRegister(PhysicalRegister reg, ReservationStation::Entry& entry);
 
-        void renameFloatRegister(FloatRegister fReg);
+        RegisterAllocationTable::Rename renameRegister(Register reg);
+
+        RegisterAllocationTable::Rename renameFloatRegister(FloatRegister fReg);
+
+        /// The renaming instruction retired, nobody can read the previous register anymore
+        void retireRename(const RegisterAllocationTable::Rename& rename);
+
+        /// The renaming instruction was thrown away, renames must be undone from the youngest one
+        void undoRename(const RegisterAllocationTable::Rename& rename);
+
+        /// The renaming instruction was thrown away and the rat is restored from a checkpoint, only the register is freed
+        void releaseRename(const RegisterAllocationTable::Rename& rename);
 
         const RegisterAllocationTable& getRat() const;
 
-        void subscribeRegisterRead(PhysicalRegister reg);
+        MemoryWrite::Id registerPendingWrite(std::size_t storePc, Memory::Immediate mem);
 
-        void unsubscribeRegisterRead(PhysicalRegister reg);
+        MemoryWrite::Id registerPendingWrite(std::size_t storePc);
 
-        MemoryWrite::Id registerPendingWrite(Memory::Immediate mem);
+        /// Loads that read the address too early are marked to be replayed
+        void specifyWriteAddress(MemoryWrite::Id id, uint64_t address, std::size_t storePc);
 
-        MemoryWrite::Id registerPendingWrite();
+        /// Store the load should wait for before reading memory, 0 if none
+        MemoryWrite::Id predictStoreDependency(std::size_t loadPc) const;
 
-        void specifyWriteAddress(MemoryWrite::Id id, uint64_t value);
+        /// Load retired or was thrown away, it is no longer speculative
+        void removeLoad(const ReservationStation::Entry& load);
 
-        void unrollSpeculation(const RegisterAllocationTable& rat);
+        /// Load read a stale value, it is thrown away along with everything younger and fetched again
+        void replayLoad();
+
+        void unrollSpeculation();
 
         void flushPipeline();
 
@@ -167,32 +434,66 @@ namespace tiny::t86 {
 
         void setMemory(uint64_t address, uint64_t value);
 
+        /// Functional mode only, nothing is renamed and nothing waits there, so the value lies right in the register file
+        int64_t& architecturalRegister(Register reg) {
+            return registers_[rat_.translate(reg).index()].value;
+        }
+
+        /// Bits of the double
+        int64_t& architecturalRegister(FloatRegister fReg) {
+            return registers_[rat_.translate(fReg).index()].value;
+        }
+
     private:
         // Branch processing
-        void checkBranchPrediction(const ReservationStation::Entry& entry, uint64_t destination);
+        void checkBranchPrediction(const ReservationStation::Entry& entry, uint64_t destination, bool taken);
+
+        void registerBranchNotTaken(uint64_t sourcePc, const JumpInstruction& instruction);
+
+        void registerBranchTaken(uint64_t sourcePc, const JumpInstruction& instruction, uint64_t destination);
+
+        // Throws away everything younger than the jump and continues fetching from the destination
+        void recoverFromMisprediction(const ReservationStation::Entry& jump, uint64_t destination);
 
-        void registerBranchNotTaken(uint64_t sourcePc);
+        static std::unique_ptr<BranchPredictor> createBranchPredictor(const std::string& name);
 
-        void registerBranchTaken(uint64_t sourcePc, uint64_t destination);
+        static FunctionalUnits createFunctionalUnits(std::size_t aluCnt);
 
-        PhysicalRegister nextFreeRegister() const;
+        /// Null for none
+        static std::unique_ptr<Prefetcher> createPrefetcher(const std::string& name);
+
+        RegisterAllocationTable::Rename rename(std::size_t logical);
+
+        void wakeUpWaiting(PhysicalRegister reg);
+
+        void fastForward();
 
         // Harvard architecture
         Program program_;
 
+        // Decoded once in start, fetch and the reservation station use only this
+        DecodedProgram decodedProgram_;
+
         uint64_t speculativeProgramCounter_{0};
 
         struct InstructionEntry {
-            const Instruction* instruction;
+            const DecodedInstruction* decoded;
             std::size_t pc;
             std::size_t loggingId;
+            // Only for jumps
+            JumpPrediction prediction;
         };
 
         InstructionEntry fetchInstruction();
 
-        std::optional<InstructionEntry> instructionFetch_;
+        // Throws away everything fetched or decoded, that is not yet dispatched
+        void clearFrontEnd();
 
-        std::optional<InstructionEntry> instructionDecode_;
+        // Fetched instructions waiting for decode, bounded by the fetch queue size
+        std::deque<InstructionEntry> fetchQueue_;
+
+        // Decoded instructions waiting for dispatch, at most decode width of them
+        std::deque<InstructionEntry> decodeQueue_;
 
         ReservationStation reservationStation_; // ReservationStations
 
@@ -206,7 +507,8 @@ namespace tiny::t86 {
         struct RegisterValue {
             int64_t value{0};
             bool ready{false};
-            std::size_t subscribedReads{0};
+            // Entries to wake up once the value is ready
+            std::vector<ReservationStation::Entry*> waiting;
         };
 
         // Values of registers, indexed by PhysicalRegister
@@ -215,12 +517,44 @@ namespace tiny::t86 {
         // Register allocation table
         RegisterAllocationTable rat_;
 
+        // Register is referenced while mapped in the rat, or while it is the previous register of a rename that has not retired yet
+        RegisterAllocator registerAllocator_;
+
         RAM ram_;
 
-        MemoryWritesManager writesManager_;
+        // Null without prefetching
+        std::unique_ptr<Prefetcher> prefetcher_;
+
+        StoreQueue storeQueue_;
+
+        bool fastForward_;
+
+        bool speculativeLoads_;
+
+        LoadQueue loadQueue_;
+
+        StoreSetPredictor storeSetPredictor_;
+
+        // Used by step
+        FunctionalInterpreter functionalInterpreter_{*this};
+
+        // Updated on fetch
+        ReturnAddressStack returnAddressStack_;
+
+        // Updated on retirement, speculative stack is restored from it when speculation is thrown away
+        ReturnAddressStack retiredReturnAddressStack_;
+
+        BranchTargetBuffer branchTargetBuffer_;
+
+        bool resolveBranchesAtExecute_;
+
+        std::size_t fetchWidth_;
+
+        std::size_t decodeWidth_;
+
+        std::size_t dispatchWidth_;
 
-        // list of predicted jump destinations
-        std::list<uint64_t> predictions_;
+        std::size_t fetchQueueSize_;
 
         std::function<void(Cpu&)> breakHandler_;
 
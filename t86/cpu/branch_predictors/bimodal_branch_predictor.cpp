@@ -0,0 +1,22 @@
+#include "bimodal_branch_predictor.h"
+
+#include <cassert>
+
+namespace tiny::t86 {
+    BimodalBranchPredictor::BimodalBranchPredictor(std::size_t size) : counters_(size, 2) {
+        assert((size & (size - 1)) == 0 && "Size must be a power of two");
+    }
+
+    bool BimodalBranchPredictor::predict(uint64_t pc, uint64_t) const {
+        return counters_[pc & (counters_.size() - 1)] >= 2;
+    }
+
+    void BimodalBranchPredictor::update(uint64_t pc, uint64_t, bool taken) {
+        uint8_t& counter = counters_[pc & (counters_.size() - 1)];
+        if (taken && counter < 3) {
+            ++counter;
+        } else if (!taken && counter > 0) {
+            --counter;
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "direction_branch_predictor.h"
+
+namespace tiny::t86 {
+    /// Table of 2-bit saturating counters indexed by the pc
+    class BimodalBranchPredictor : public DirectionBranchPredictor {
+    public:
+        /// Size must be a power of two
+        explicit BimodalBranchPredictor(std::size_t size = 4096);
+
+    protected:
+        bool predict(uint64_t pc, uint64_t history) const override;
+
+        void update(uint64_t pc, uint64_t history, bool taken) override;
+
+    private:
+        // 0 and 1 predict not taken, 2 and 3 taken, starts weakly taken
+        std::vector<uint8_t> counters_;
+    };
+}
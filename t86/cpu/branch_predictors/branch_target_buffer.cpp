@@ -0,0 +1,42 @@
+#include "branch_target_buffer.h"
+
+namespace tiny::t86 {
+    BranchTargetBuffer::BranchTargetBuffer(std::size_t sets, std::size_t ways)
+            : sets_(sets), ways_(ways), entries_(sets * ways) {}
+
+    BranchTargetBuffer::Entry* BranchTargetBuffer::find(uint64_t pc) {
+        Entry* set = &entries_[(pc % sets_) * ways_];
+        for (std::size_t i = 0; i < ways_; ++i) {
+            if (set[i].valid && set[i].tag == pc / sets_) {
+                return &set[i];
+            }
+        }
+        return nullptr;
+    }
+
+    std::optional<uint64_t> BranchTargetBuffer::lookup(uint64_t pc) {
+        if (Entry* entry = find(pc)) {
+            entry->lastUse = ++useCounter_;
+            return entry->target;
+        }
+        return std::nullopt;
+    }
+
+    void BranchTargetBuffer::update(uint64_t pc, uint64_t target) {
+        Entry* entry = find(pc);
+        if (!entry) {
+            // Invalid entries have lastUse 0, so they go first
+            Entry* set = &entries_[(pc % sets_) * ways_];
+            entry = set;
+            for (std::size_t i = 1; i < ways_; ++i) {
+                if (set[i].lastUse < entry->lastUse) {
+                    entry = &set[i];
+                }
+            }
+            entry->valid = true;
+            entry->tag = pc / sets_;
+        }
+        entry->target = target;
+        entry->lastUse = ++useCounter_;
+    }
+}
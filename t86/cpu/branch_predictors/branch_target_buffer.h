@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+namespace tiny::t86 {
+    /**
+     * Remembers the last target of indirect jumps, whose destination is not known at fetch.
+     * Set associative, the set is chosen by the pc, least recently used way is replaced.
+     */
+    class BranchTargetBuffer {
+    public:
+        /// No sets means the buffer is disabled
+        BranchTargetBuffer(std::size_t sets, std::size_t ways);
+
+        bool enabled() const {
+            return !entries_.empty();
+        }
+
+        std::optional<uint64_t> lookup(uint64_t pc);
+
+        void update(uint64_t pc, uint64_t target);
+
+    private:
+        struct Entry {
+            bool valid{false};
+            uint64_t tag{0};
+            uint64_t target{0};
+            std::size_t lastUse{0};
+        };
+
+        Entry* find(uint64_t pc);
+
+        std::size_t sets_;
+
+        std::size_t ways_;
+
+        // Ways of a set are next to each other
+        std::vector<Entry> entries_;
+
+        std::size_t useCounter_{0};
+    };
+}
@@ -0,0 +1,43 @@
+#include "direction_branch_predictor.h"
+
+namespace tiny::t86 {
+    uint64_t DirectionBranchPredictor::nextGuess(uint64_t pc, const JumpInstruction& instruction, std::optional<uint64_t> target) {
+        if (!instruction.isConditional()) {
+            return target.value_or(pc + 1);
+        }
+        // Without target, the jump is guessed as not taken, history has to match the guess
+        bool taken = target && predict(pc, speculativeHistory_);
+        speculativeHistory_ = (speculativeHistory_ << 1) | taken;
+        return taken ? *target : pc + 1;
+    }
+
+    void DirectionBranchPredictor::registerBranchTaken(uint64_t pc, const JumpInstruction& instruction, uint64_t) {
+        retire(pc, instruction, true);
+    }
+
+    void DirectionBranchPredictor::registerBranchNotTaken(uint64_t pc, const JumpInstruction& instruction) {
+        retire(pc, instruction, false);
+    }
+
+    void DirectionBranchPredictor::retire(uint64_t pc, const JumpInstruction& instruction, bool taken) {
+        if (instruction.isConditional()) {
+            update(pc, history_, taken);
+            history_ = (history_ << 1) | taken;
+        }
+    }
+
+    void DirectionBranchPredictor::squash() {
+        speculativeHistory_ = history_;
+    }
+
+    uint64_t DirectionBranchPredictor::checkpoint() const {
+        return speculativeHistory_;
+    }
+
+    void DirectionBranchPredictor::restore(uint64_t checkpoint, const JumpInstruction& instruction, bool taken) {
+        speculativeHistory_ = checkpoint;
+        if (instruction.isConditional()) {
+            speculativeHistory_ = (speculativeHistory_ << 1) | taken;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../../instruction.h"
+#include "../branchpredictor.h"
+
+namespace tiny::t86 {
+    /**
+     * Base of predictors that guess only whether a conditional jump is taken.
+     * Unconditional jumps go to their target, jumps with target unknown at fetch continue with the next instruction.
+     * Global history of conditional jumps is kept, one bit per jump, set if it was taken.
+     * The speculative history is updated on fetch and restored from the retired one on squash,
+     * or from the checkpoint of a mispredicted jump.
+     */
+    class DirectionBranchPredictor : public BranchPredictor {
+    public:
+        uint64_t nextGuess(uint64_t pc, const JumpInstruction& instruction, std::optional<uint64_t> target) override;
+
+        void registerBranchTaken(uint64_t pc, const JumpInstruction& instruction, uint64_t destination) override;
+
+        void registerBranchNotTaken(uint64_t pc, const JumpInstruction& instruction) override;
+
+        void squash() override;
+
+        uint64_t checkpoint() const override;
+
+        void restore(uint64_t checkpoint, const JumpInstruction& instruction, bool taken) override;
+
+    protected:
+        // History is the one before the jump, both in predict and update, so they see the same one
+        virtual bool predict(uint64_t pc, uint64_t history) const = 0;
+
+        virtual void update(uint64_t pc, uint64_t history, bool taken) = 0;
+
+    private:
+        void retire(uint64_t pc, const JumpInstruction& instruction, bool taken);
+
+        uint64_t speculativeHistory_{0};
+
+        uint64_t history_{0};
+    };
+}
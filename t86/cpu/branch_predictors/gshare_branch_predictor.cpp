@@ -0,0 +1,26 @@
+#include "gshare_branch_predictor.h"
+
+#include <cassert>
+
+namespace tiny::t86 {
+    GshareBranchPredictor::GshareBranchPredictor(std::size_t size) : counters_(size, 2) {
+        assert((size & (size - 1)) == 0 && "Size must be a power of two");
+    }
+
+    std::size_t GshareBranchPredictor::index(uint64_t pc, uint64_t history) const {
+        return (pc ^ history) & (counters_.size() - 1);
+    }
+
+    bool GshareBranchPredictor::predict(uint64_t pc, uint64_t history) const {
+        return counters_[index(pc, history)] >= 2;
+    }
+
+    void GshareBranchPredictor::update(uint64_t pc, uint64_t history, bool taken) {
+        uint8_t& counter = counters_[index(pc, history)];
+        if (taken && counter < 3) {
+            ++counter;
+        } else if (!taken && counter > 0) {
+            --counter;
+        }
+    }
+}
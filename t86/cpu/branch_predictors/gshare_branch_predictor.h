@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "direction_branch_predictor.h"
+
+namespace tiny::t86 {
+    /// 2-bit saturating counters indexed by the pc xored with the global history
+    class GshareBranchPredictor : public DirectionBranchPredictor {
+    public:
+        /// Uses as many bits of history as is needed to index the table, size must be a power of two
+        explicit GshareBranchPredictor(std::size_t size = 4096);
+
+    protected:
+        bool predict(uint64_t pc, uint64_t history) const override;
+
+        void update(uint64_t pc, uint64_t history, bool taken) override;
+
+    private:
+        std::size_t index(uint64_t pc, uint64_t history) const;
+
+        // 0 and 1 predict not taken, 2 and 3 taken, starts weakly taken
+        std::vector<uint8_t> counters_;
+    };
+}
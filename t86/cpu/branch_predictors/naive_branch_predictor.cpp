@@ -1,9 +1,8 @@
 #include "naive_branch_predictor.h"
 
-uint64_t tiny::t86::NaiveBranchPredictor::nextGuess(uint64_t pc, const JumpInstruction& instruction) const {
-    const Operand& destination = instruction.getDestination();
-    if (destination.isFetched()) {
-        return destination.getValue();
+uint64_t tiny::t86::NaiveBranchPredictor::nextGuess(uint64_t pc, const JumpInstruction&, std::optional<uint64_t> target) {
+    if (target) {
+        return *target;
     }
     else {
         // Just continue, without any special treatment
@@ -11,6 +10,6 @@ uint64_t tiny::t86::NaiveBranchPredictor::nextGuess(uint64_t pc, const JumpInstr
     }
 }
 
-void tiny::t86::NaiveBranchPredictor::registerBranchTaken(uint64_t, uint64_t) {}
+void tiny::t86::NaiveBranchPredictor::registerBranchTaken(uint64_t, const JumpInstruction&, uint64_t) {}
 
-void tiny::t86::NaiveBranchPredictor::registerBranchNotTaken(uint64_t) {}
+void tiny::t86::NaiveBranchPredictor::registerBranchNotTaken(uint64_t, const JumpInstruction&) {}
@@ -0,0 +1,42 @@
+#include "return_address_stack.h"
+
+namespace tiny::t86 {
+    ReturnAddressStack::ReturnAddressStack(std::size_t size) : entries_(size) {}
+
+    void ReturnAddressStack::push(uint64_t address) {
+        if (entries_.empty()) {
+            return;
+        }
+        top_ = top_ + 1 == entries_.size() ? 0 : top_ + 1;
+        entries_[top_] = address;
+        if (count_ < entries_.size()) {
+            ++count_;
+        }
+    }
+
+    std::optional<uint64_t> ReturnAddressStack::pop() {
+        if (count_ == 0) {
+            return std::nullopt;
+        }
+        uint64_t address = entries_[top_];
+        top_ = top_ == 0 ? entries_.size() - 1 : top_ - 1;
+        --count_;
+        return address;
+    }
+
+    ReturnAddressStack::Checkpoint ReturnAddressStack::checkpoint() const {
+        if (entries_.empty()) {
+            return {};
+        }
+        return {top_, count_, entries_[top_]};
+    }
+
+    void ReturnAddressStack::restore(const Checkpoint& checkpoint) {
+        if (entries_.empty()) {
+            return;
+        }
+        top_ = checkpoint.top;
+        count_ = checkpoint.count;
+        entries_[top_] = checkpoint.address;
+    }
+}
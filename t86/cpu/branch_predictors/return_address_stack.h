@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+namespace tiny::t86 {
+    /**
+     * Predicts where RET goes, CALL pushes the address after itself and RET pops it.
+     * Fixed size circular buffer, when full the oldest address is overwritten.
+     */
+    class ReturnAddressStack {
+    public:
+        /// Enough to repair the stack after wrong path pushes and pops, only the top slot can be overwritten before
+        struct Checkpoint {
+            std::size_t top{0};
+            std::size_t count{0};
+            uint64_t address{0};
+        };
+
+        explicit ReturnAddressStack(std::size_t size);
+
+        void push(uint64_t address);
+
+        /// Nothing if the stack is empty, or all the addresses were overwritten
+        std::optional<uint64_t> pop();
+
+        Checkpoint checkpoint() const;
+
+        void restore(const Checkpoint& checkpoint);
+
+        /// Zero when the stack is disabled
+        std::size_t capacity() const {
+            return entries_.size();
+        }
+
+    private:
+        std::vector<uint64_t> entries_;
+
+        std::size_t top_{0};
+
+        std::size_t count_{0};
+    };
+}
@@ -0,0 +1,119 @@
+#include "tage_branch_predictor.h"
+
+#include <cassert>
+
+namespace tiny::t86 {
+    TageBranchPredictor::TageBranchPredictor(std::size_t baseSize, std::size_t tableSize) : base_(baseSize, 2) {
+        assert((baseSize & (baseSize - 1)) == 0 && (tableSize & (tableSize - 1)) == 0 && "Sizes must be powers of two");
+        for (auto& table : tables_) {
+            table.resize(tableSize);
+        }
+    }
+
+    uint64_t TageBranchPredictor::fold(uint64_t history, std::size_t length, std::size_t bits) {
+        if (length < 64) {
+            history &= (uint64_t{1} << length) - 1;
+        }
+        uint64_t folded = 0;
+        while (history) {
+            folded ^= history & ((uint64_t{1} << bits) - 1);
+            history >>= bits;
+        }
+        return folded;
+    }
+
+    TageBranchPredictor::Lookup TageBranchPredictor::lookup(uint64_t pc, uint64_t history) const {
+        Lookup l;
+        for (std::size_t i = 0; i < tableCnt; ++i) {
+            std::size_t size = tables_[i].size();
+            std::size_t indexBits = __builtin_ctzll(size);
+            l.indices[i] = (pc ^ (pc >> indexBits) ^ fold(history, historyLengths[i], indexBits)) & (size - 1);
+            l.tags[i] = (pc ^ fold(history, historyLengths[i], tagBits) ^ (fold(history, historyLengths[i], tagBits - 1) << 1))
+                        & ((1 << tagBits) - 1);
+        }
+        for (std::size_t i = tableCnt; i-- > 0;) {
+            const Entry& entry = tables_[i][l.indices[i]];
+            if (entry.valid && entry.tag == l.tags[i]) {
+                if (l.provider == tableCnt) {
+                    l.provider = i;
+                } else {
+                    l.alternative = i;
+                    break;
+                }
+            }
+        }
+        return l;
+    }
+
+    bool TageBranchPredictor::basePrediction(uint64_t pc) const {
+        return base_[pc & (base_.size() - 1)] >= 2;
+    }
+
+    bool TageBranchPredictor::prediction(const Lookup& l, std::size_t table, uint64_t pc) const {
+        if (table == tableCnt) {
+            return basePrediction(pc);
+        }
+        return tables_[table][l.indices[table]].counter >= 0;
+    }
+
+    bool TageBranchPredictor::predict(uint64_t pc, uint64_t history) const {
+        Lookup l = lookup(pc, history);
+        return prediction(l, l.provider, pc);
+    }
+
+    void TageBranchPredictor::update(uint64_t pc, uint64_t history, bool taken) {
+        Lookup l = lookup(pc, history);
+        bool predicted = prediction(l, l.provider, pc);
+
+        if (l.provider == tableCnt) {
+            uint8_t& counter = base_[pc & (base_.size() - 1)];
+            if (taken && counter < 3) {
+                ++counter;
+            } else if (!taken && counter > 0) {
+                --counter;
+            }
+        } else {
+            Entry& entry = tables_[l.provider][l.indices[l.provider]];
+            if (predicted != prediction(l, l.alternative, pc)) {
+                // Provider made the difference
+                if (predicted == taken && entry.useful < 3) {
+                    ++entry.useful;
+                } else if (predicted != taken && entry.useful > 0) {
+                    --entry.useful;
+                }
+            }
+            if (taken && entry.counter < 3) {
+                ++entry.counter;
+            } else if (!taken && entry.counter > -4) {
+                --entry.counter;
+            }
+        }
+
+        // Allocate an entry with longer history
+        if (predicted != taken) {
+            std::size_t first = l.provider == tableCnt ? 0 : l.provider + 1;
+            bool allocated = false;
+            for (std::size_t i = first; i < tableCnt; ++i) {
+                Entry& entry = tables_[i][l.indices[i]];
+                if (entry.useful == 0) {
+                    entry = {true, l.tags[i], static_cast<int8_t>(taken ? 0 : -1), 0};
+                    allocated = true;
+                    break;
+                }
+            }
+            if (!allocated) {
+                for (std::size_t i = first; i < tableCnt; ++i) {
+                    --tables_[i][l.indices[i]].useful;
+                }
+            }
+        }
+
+        if (++updates_ % usefulResetPeriod == 0) {
+            for (auto& table : tables_) {
+                for (auto& entry : table) {
+                    entry.useful >>= 1;
+                }
+            }
+        }
+    }
+}
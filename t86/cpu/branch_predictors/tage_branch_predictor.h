@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "direction_branch_predictor.h"
+
+namespace tiny::t86 {
+    /**
+     * Simplified TAGE predictor.
+     * Bimodal base table and tagged tables indexed by the pc hashed with geometrically longer global histories.
+     * The longest matching table provides the prediction. After a misprediction, an entry is allocated
+     * in a table with longer history than the provider's.
+     */
+    class TageBranchPredictor : public DirectionBranchPredictor {
+    public:
+        static constexpr std::size_t tableCnt = 4;
+
+        static constexpr std::array<std::size_t, tableCnt> historyLengths = { 5, 12, 27, 60 };
+
+        /// Sizes must be powers of two
+        explicit TageBranchPredictor(std::size_t baseSize = 4096, std::size_t tableSize = 1024);
+
+    protected:
+        bool predict(uint64_t pc, uint64_t history) const override;
+
+        void update(uint64_t pc, uint64_t history, bool taken) override;
+
+    private:
+        static constexpr std::size_t tagBits = 9;
+
+        // Useful counters are halved after this many updates, so that stale entries can be replaced
+        static constexpr std::size_t usefulResetPeriod = 1 << 18;
+
+        struct Entry {
+            bool valid{false};
+            uint16_t tag{0};
+            // -4 to 3, taken if not negative
+            int8_t counter{0};
+            // 0 to 3
+            uint8_t useful{0};
+        };
+
+        struct Lookup {
+            std::array<std::size_t, tableCnt> indices;
+            std::array<uint16_t, tableCnt> tags;
+            // tableCnt if no table matched
+            std::size_t provider{tableCnt};
+            std::size_t alternative{tableCnt};
+        };
+
+        Lookup lookup(uint64_t pc, uint64_t history) const;
+
+        bool basePrediction(uint64_t pc) const;
+
+        bool prediction(const Lookup& l, std::size_t table, uint64_t pc) const;
+
+        // History cut to length and folded into bits by xoring
+        static uint64_t fold(uint64_t history, std::size_t length, std::size_t bits);
+
+        std::vector<uint8_t> base_;
+
+        std::array<std::vector<Entry>, tableCnt> tables_;
+
+        std::size_t updates_{0};
+    };
+}
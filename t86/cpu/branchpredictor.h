@@ -3,6 +3,7 @@
 #include "../instruction.h"
 
 #include <cstddef>
+#include <optional>
 
 namespace tiny::t86 {
     class BranchPredictor {
@@ -11,11 +12,24 @@ namespace tiny::t86 {
 
         // Instruction pointer would be unique
         // but pc is provided so that the predictor can predict some relative jumps
+        // Target is where the jump goes if taken, when the cpu knows it at fetch
+        // Called on fetch, so the predictor may update its speculative state
         // Returns new pc
-        virtual uint64_t nextGuess(uint64_t pc, const JumpInstruction& instruction) const = 0;
+        virtual uint64_t nextGuess(uint64_t pc, const JumpInstruction& instruction, std::optional<uint64_t> target) = 0;
 
-        virtual void registerBranchTaken(uint64_t pc, uint64_t destination) = 0;
+        // Called when the jump retires, in program order
+        virtual void registerBranchTaken(uint64_t pc, const JumpInstruction& instruction, uint64_t destination) = 0;
 
-        virtual void registerBranchNotTaken(uint64_t pc) = 0;
+        virtual void registerBranchNotTaken(uint64_t pc, const JumpInstruction& instruction) = 0;
+
+        // All guesses not yet registered were thrown away
+        virtual void squash() {}
+
+        // Speculative state before a jump is guessed, kept with the jump
+        virtual uint64_t checkpoint() const { return 0; }
+
+        // The jump was mispredicted, guesses after it were thrown away
+        // State goes back to the checkpoint taken before the jump and the real outcome of the jump is applied
+        virtual void restore(uint64_t /*checkpoint*/, const JumpInstruction& /*instruction*/, bool /*taken*/) {}
     };
 }
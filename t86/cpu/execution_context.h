@@ -0,0 +1,68 @@
+#pragma once
+
+#include "alu.h"
+#include "register.h"
+#include "memory_write.h"
+
+#include <vector>
+
+namespace tiny::t86 {
+    // Forward declaration
+    class Cpu;
+
+    class Operand;
+
+    /**
+     * Everything an instruction can see while it is being executed and retired.
+     * The out-of-order pipeline implements this with ReservationStation::Entry,
+     * the functional mode with FunctionalContext, so both run the very same Instruction objects.
+     */
+    class ExecutionContext {
+    public:
+        virtual ~ExecutionContext() = default;
+
+        // Already fetched operands of the instruction
+        virtual std::vector<Operand>& operands() = 0;
+
+        virtual const std::vector<Operand>& operands() const = 0;
+
+        // One id for each memory product of the instruction
+        virtual const std::vector<MemoryWrite::Id>& memoryWriteIds() const = 0;
+
+        virtual Cpu& cpu() const = 0;
+
+        virtual void setRegister(Register reg, int64_t val) = 0;
+
+        virtual void setFloatRegister(FloatRegister fReg, double val) = 0;
+
+        virtual void specifyWriteAddress(MemoryWrite::Id id, std::size_t address) = 0;
+
+        virtual void setWriteValue(MemoryWrite::Id id, uint64_t value) = 0;
+
+        virtual void writeMemory(MemoryWrite::Id id) = 0;
+
+        // Hint that the address will be read soon, it has no effect on the values
+        virtual void prefetch(uint64_t address) = 0;
+
+        virtual void processJump(bool taken) = 0;
+
+        virtual void unrollSpeculation() = 0;
+
+        void setProgramCounter(uint64_t address) {
+            setRegister(Register::ProgramCounter(), address);
+        }
+
+        void setFlags(Alu::Flags flags) {
+            setRegister(Register::Flags(), flags);
+        }
+
+        void setStackPointer(uint64_t address) {
+            setRegister(Register::StackPointer(), address);
+        }
+
+        // TODO maybe remove, not really used
+        void setStackBasePointer(uint64_t address) {
+            setRegister(Register::StackBasePointer(), address);
+        }
+    };
+}
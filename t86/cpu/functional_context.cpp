@@ -0,0 +1,77 @@
+#include "functional_context.h"
+#include "../cpu.h"
+#include "../program/decoded_program.h"
+
+#include <cassert>
+#include <numeric>
+
+namespace tiny::t86 {
+    FunctionalContext::FunctionalContext(Cpu& cpu) : cpu_(cpu) {}
+
+    void FunctionalContext::start(const DecodedInstruction& decoded) {
+        const auto& program = cpu_.decodedProgram();
+        auto operands = program.operands(decoded);
+        operands_.assign(operands.begin(), operands.end());
+        if (memWriteIds_.size() != decoded.memoryWritesCount) {
+            memWriteIds_.resize(decoded.memoryWritesCount);
+            std::iota(memWriteIds_.begin(), memWriteIds_.end(), 0);
+        }
+        writeAddresses_.clear();
+        if (decoded.memoryWritesCount) {
+            for (const auto& product : program.produces(decoded)) {
+                if (product.isMemoryImmediate()) {
+                    writeAddresses_.emplace_back(product.getMemoryImmediate().index());
+                } else if (product.isMemoryRegister()) {
+                    writeAddresses_.emplace_back();
+                }
+            }
+        }
+        fetchOperands();
+    }
+
+    void FunctionalContext::fetchOperands() {
+        for (Operand& operand : operands_) {
+            // Most operands are a plain register, those skip the requirements
+            if (operand.isRegister()) {
+                operand = Operand(cpu_.architecturalRegister(operand.getRegister()));
+                continue;
+            }
+            while (!operand.isFetched()) {
+                Requirement requirement = operand.requirement();
+                if (requirement.isRegisterRead()) {
+                    operand.supply(cpu_.architecturalRegister(requirement.getRegisterRead()));
+                } else if (requirement.isFloatRegisterRead()) {
+                    int64_t bits = cpu_.architecturalRegister(requirement.getFloatRegisterRead());
+                    operand.supply(*reinterpret_cast<double*>(&bits));
+                } else if (requirement.isMemoryRead()) {
+                    operand.supply(static_cast<int64_t>(cpu_.getMemory(requirement.getMemoryRead())));
+                } else {
+                    assert(false && "Unhandled requirement type");
+                }
+            }
+        }
+    }
+
+    Cpu& FunctionalContext::cpu() const {
+        return cpu_;
+    }
+
+    void FunctionalContext::setRegister(Register reg, int64_t val) {
+        cpu_.architecturalRegister(reg) = val;
+    }
+
+    void FunctionalContext::setFloatRegister(FloatRegister fReg, double val) {
+        cpu_.architecturalRegister(fReg) = *reinterpret_cast<int64_t*>(&val);
+    }
+
+    void FunctionalContext::specifyWriteAddress(MemoryWrite::Id id, std::size_t address) {
+        assert(!writeAddresses_[id] && "Address of the write is already known");
+        writeAddresses_[id] = address;
+    }
+
+    void FunctionalContext::setWriteValue(MemoryWrite::Id id, uint64_t value) {
+        // The value is always set after the address is known
+        assert(writeAddresses_[id]);
+        cpu_.setMemory(*writeAddresses_[id], value);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "execution_context.h"
+#include "../instructions/operand.h"
+
+#include <optional>
+#include <vector>
+
+namespace tiny::t86 {
+    struct DecodedInstruction;
+
+    /**
+     * Execution context of the functional mode.
+     * The instruction is executed and retired right away against architectural state of the cpu,
+     * there is no renaming, no speculation and no memory latency.
+     * FunctionalInterpreter uses it only for the instructions that need their own state, such as input and output.
+     */
+    class FunctionalContext : public ExecutionContext {
+    public:
+        explicit FunctionalContext(Cpu& cpu);
+
+        /// Prepares the context for the instruction, its operands are fetched right away
+        void start(const DecodedInstruction& decoded);
+
+        std::vector<Operand>& operands() override {
+            return operands_;
+        }
+
+        const std::vector<Operand>& operands() const override {
+            return operands_;
+        }
+
+        const std::vector<MemoryWrite::Id>& memoryWriteIds() const override {
+            return memWriteIds_;
+        }
+
+        Cpu& cpu() const override;
+
+        void setRegister(Register reg, int64_t val) override;
+
+        void setFloatRegister(FloatRegister fReg, double val) override;
+
+        void specifyWriteAddress(MemoryWrite::Id id, std::size_t address) override;
+
+        void setWriteValue(MemoryWrite::Id id, uint64_t value) override;
+
+        // Memory was already written when the value was set
+        void writeMemory(MemoryWrite::Id) override {}
+
+        // Memory takes no time here
+        void prefetch(uint64_t) override {}
+
+        // Pc was already set by execute, nothing can be mispredicted
+        void processJump(bool) override {}
+
+        // There is no speculation to unroll
+        void unrollSpeculation() override {}
+
+    private:
+        void fetchOperands();
+
+        Cpu& cpu_;
+
+        std::vector<Operand> operands_;
+
+        // Ids are just indices of the memory products of the instruction
+        std::vector<MemoryWrite::Id> memWriteIds_;
+
+        // Indexed by MemoryWrite::Id, the value goes to memory as soon as it is set
+        std::vector<std::optional<std::size_t>> writeAddresses_;
+    };
+}
@@ -0,0 +1,477 @@
+#include "functional_interpreter.h"
+#include "../cpu.h"
+#include "../program/decoded_program.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace tiny::t86 {
+    namespace {
+        Alu::Result negate(int64_t x, int64_t) {
+            return Alu::negate(x);
+        }
+
+        Alu::Result bitNot(int64_t x, int64_t) {
+            return Alu::bit_not(x);
+        }
+
+        double toDouble(int64_t bits) {
+            return *reinterpret_cast<double*>(&bits);
+        }
+
+        int64_t toBits(double value) {
+            return *reinterpret_cast<int64_t*>(&value);
+        }
+
+        // Same conditions as the jump instructions, JMP jumps always
+        bool (*jumpCondition(Instruction::Type type))(Alu::Flags) {
+            switch (type) {
+                case Instruction::Type::JMP:
+                    return [](Alu::Flags) { return true; };
+                case Instruction::Type::JZ:
+                case Instruction::Type::JE:
+                    return [](Alu::Flags flags) { return flags.zeroFlag; };
+                case Instruction::Type::JNZ:
+                case Instruction::Type::JNE:
+                    return [](Alu::Flags flags) { return !flags.zeroFlag; };
+                case Instruction::Type::JG:
+                    return [](Alu::Flags flags) { return !flags.zeroFlag && (flags.signFlag == flags.overflowFlag); };
+                case Instruction::Type::JGE:
+                    return [](Alu::Flags flags) { return flags.signFlag == flags.overflowFlag; };
+                case Instruction::Type::JL:
+                    return [](Alu::Flags flags) { return flags.signFlag != flags.overflowFlag; };
+                case Instruction::Type::JLE:
+                    return [](Alu::Flags flags) { return flags.zeroFlag || flags.signFlag != flags.overflowFlag; };
+                case Instruction::Type::JA:
+                    return [](Alu::Flags flags) { return !(flags.carryFlag || flags.zeroFlag); };
+                case Instruction::Type::JAE:
+                    return [](Alu::Flags flags) { return !flags.carryFlag; };
+                case Instruction::Type::JB:
+                    return [](Alu::Flags flags) { return flags.carryFlag; };
+                case Instruction::Type::JBE:
+                    return [](Alu::Flags flags) { return flags.carryFlag || flags.zeroFlag; };
+                case Instruction::Type::JO:
+                    return [](Alu::Flags flags) { return flags.overflowFlag; };
+                case Instruction::Type::JNO:
+                    return [](Alu::Flags flags) { return !flags.overflowFlag; };
+                case Instruction::Type::JS:
+                    return [](Alu::Flags flags) { return flags.signFlag; };
+                case Instruction::Type::JNS:
+                    return [](Alu::Flags flags) { return !flags.signFlag; };
+                default:
+                    throw std::runtime_error("Not a jump instruction " + Instruction::typeToString(type));
+            }
+        }
+
+        Alu::Result (*arithmetic(Instruction::Type type))(int64_t, int64_t) {
+            switch (type) {
+                case Instruction::Type::ADD:
+                case Instruction::Type::INC:
+                    return &Alu::add;
+                case Instruction::Type::SUB:
+                case Instruction::Type::DEC:
+                case Instruction::Type::CMP:
+                    return &Alu::subtract;
+                case Instruction::Type::NEG:
+                    return &negate;
+                case Instruction::Type::MUL:
+                    return &Alu::multiply;
+                case Instruction::Type::DIV:
+                    return &Alu::divide;
+                case Instruction::Type::MOD:
+                    return &Alu::mod;
+                case Instruction::Type::IMUL:
+                    return &Alu::signed_multiply;
+                case Instruction::Type::IDIV:
+                    return &Alu::signed_divide;
+                case Instruction::Type::AND:
+                    return &Alu::bit_and;
+                case Instruction::Type::OR:
+                    return &Alu::bit_or;
+                case Instruction::Type::XOR:
+                    return &Alu::bit_xor;
+                case Instruction::Type::NOT:
+                    return &bitNot;
+                case Instruction::Type::LSH:
+                    return &Alu::bit_left_shift;
+                case Instruction::Type::RSH:
+                    return &Alu::bit_right_shift;
+                default:
+                    throw std::runtime_error("Not an arithmetic instruction " + Instruction::typeToString(type));
+            }
+        }
+
+        Alu::FloatResult (*floatArithmetic(Instruction::Type type))(double, double) {
+            switch (type) {
+                case Instruction::Type::FADD:
+                    return &Alu::fadd;
+                case Instruction::Type::FSUB:
+                case Instruction::Type::FCMP:
+                    return &Alu::fsubtract;
+                case Instruction::Type::FMUL:
+                    return &Alu::fmultiply;
+                case Instruction::Type::FDIV:
+                    return &Alu::fdivide;
+                default:
+                    throw std::runtime_error("Not a float arithmetic instruction " + Instruction::typeToString(type));
+            }
+        }
+    }
+
+    FunctionalInterpreter::FunctionalInterpreter(Cpu& cpu) : cpu_(cpu), context_(cpu) {}
+
+    void FunctionalInterpreter::load(const DecodedProgram& program) {
+        program_ = &program;
+        pc_ = reg(Register::ProgramCounter());
+        sp_ = reg(Register::StackPointer());
+        flags_ = reg(Register::Flags());
+        ops_.clear();
+        // One more for the NOP past the end
+        ops_.reserve(program.size() + 1);
+        for (std::size_t i = 0; i <= program.size(); ++i) {
+            ops_.push_back(compile(*program.at(i).instruction));
+        }
+    }
+
+    void FunctionalInterpreter::step() {
+        uint64_t pc = *pc_;
+        const Op& op = ops_[std::min<uint64_t>(pc, ops_.size() - 1)];
+        // Same as in the pipeline, instruction sees Pc already pointing to the next one
+        *pc_ = pc + 1;
+        switch (op.kind) {
+            case Kind::Nop:
+                return;
+            case Kind::Move:
+                *op.target = read(op.first);
+                return;
+            case Kind::Store: {
+                int64_t value = read(op.first);
+                cpu_.setMemory(read(op.second), value);
+                return;
+            }
+            case Kind::Arithmetic: {
+                Alu::Result result = op.arithmetic(read(op.first), read(op.second));
+                if (op.target) {
+                    *op.target = result.value;
+                }
+                *flags_ = result.flags;
+                return;
+            }
+            case Kind::FloatArithmetic: {
+                Alu::FloatResult result = op.floatArithmetic(toDouble(read(op.first)), toDouble(read(op.second)));
+                if (op.target) {
+                    *op.target = toBits(result.value);
+                }
+                *flags_ = result.flags;
+                return;
+            }
+            case Kind::Extend:
+                *op.target = toBits(static_cast<double>(read(op.first)));
+                return;
+            case Kind::Narrow:
+                *op.target = static_cast<int64_t>(toDouble(read(op.first)));
+                return;
+            case Kind::Jump: {
+                int64_t destination = read(op.first);
+                if (op.condition(*flags_)) {
+                    *pc_ = destination;
+                }
+                return;
+            }
+            case Kind::Loop: {
+                int64_t destination = read(op.first);
+                Alu::Result result = Alu::subtract(*op.target, 1);
+                *op.target = result.value;
+                *flags_ = result.flags;
+                if (result.value != 0) {
+                    *pc_ = destination;
+                }
+                return;
+            }
+            case Kind::Call: {
+                int64_t destination = read(op.first);
+                int64_t sp = *sp_ - 1;
+                int64_t returnAddress = *pc_;
+                *pc_ = destination;
+                cpu_.setMemory(sp, returnAddress);
+                *sp_ = sp;
+                return;
+            }
+            case Kind::Return:
+                *pc_ = cpu_.getMemory(*sp_);
+                *sp_ += 1;
+                return;
+            case Kind::Push: {
+                int64_t value = read(op.first);
+                int64_t sp = *sp_ - 1;
+                cpu_.setMemory(sp, value);
+                *sp_ = sp;
+                return;
+            }
+            case Kind::Pop: {
+                int64_t sp = *sp_;
+                *op.target = cpu_.getMemory(sp);
+                *sp_ = sp + 1;
+                return;
+            }
+            case Kind::Generic: {
+                const auto& decoded = program_->at(pc);
+                context_.start(decoded);
+                decoded.instruction->execute(context_);
+                decoded.instruction->retire(context_);
+                return;
+            }
+        }
+    }
+
+    int64_t FunctionalInterpreter::read(const Source& source) const {
+        // Unsigned, so that the address arithmetic wraps around the same as in the operands
+        uint64_t value = static_cast<uint64_t>(*source.base) + source.offset + static_cast<uint64_t>(*source.index) * source.scale;
+        if (source.memory) {
+            return cpu_.getMemory(value);
+        }
+        return value;
+    }
+
+    int64_t* FunctionalInterpreter::reg(Register reg) {
+        return &cpu_.architecturalRegister(reg);
+    }
+
+    int64_t* FunctionalInterpreter::reg(FloatRegister fReg) {
+        return &cpu_.architecturalRegister(fReg);
+    }
+
+    FunctionalInterpreter::Source FunctionalInterpreter::immediate(int64_t value) const {
+        return {&zero_, &zero_, value};
+    }
+
+    FunctionalInterpreter::Source FunctionalInterpreter::compile(const Operand& operand) {
+        switch (operand.getType()) {
+            case Operand::Type::Imm:
+            case Operand::Type::FImm:
+                // Float immediates give their bits
+                return immediate(operand.getValue());
+            case Operand::Type::Reg:
+                return {reg(operand.getRegister()), &zero_};
+            case Operand::Type::FReg:
+                return {reg(operand.getFloatRegister()), &zero_};
+            case Operand::Type::RegImm: {
+                const auto& regOffset = operand.getRegisterOffset();
+                return {reg(regOffset.reg()), &zero_, regOffset.offset()};
+            }
+            case Operand::Type::RegReg: {
+                const auto& regReg = operand.getRegisterRegister();
+                return {reg(regReg.reg1()), reg(regReg.reg2()), 0, 1};
+            }
+            case Operand::Type::RegScaled: {
+                const auto& regScaled = operand.getRegisterScaled();
+                return {&zero_, reg(regScaled.reg()), 0, regScaled.scale()};
+            }
+            case Operand::Type::RegImmReg: {
+                const auto& regOffsetReg = operand.getRegisterOffsetRegister();
+                return {reg(regOffsetReg.regOffset().reg()), reg(regOffsetReg.reg()), regOffsetReg.regOffset().offset(), 1};
+            }
+            case Operand::Type::RegRegScaled: {
+                const auto& regRegScaled = operand.getRegisterRegisterScaled();
+                return {reg(regRegScaled.reg()), reg(regRegScaled.regScaled().reg()), 0, regRegScaled.regScaled().scale()};
+            }
+            case Operand::Type::RegImmRegScaled: {
+                const auto& regOffsetRegScaled = operand.getRegisterOffsetRegisterScaled();
+                return {reg(regOffsetRegScaled.regOffset().reg()), reg(regOffsetRegScaled.regScaled().reg()),
+                        regOffsetRegScaled.regOffset().offset(), regOffsetRegScaled.regScaled().scale()};
+            }
+            case Operand::Type::MemImm: {
+                Source source = immediate(operand.getMemoryImmediate().index());
+                source.memory = true;
+                return source;
+            }
+            case Operand::Type::MemReg:
+                return {reg(operand.getMemoryRegister().reg()), &zero_, 0, 0, true};
+            case Operand::Type::MemRegImm: {
+                Source source = compile(operand.getMemoryRegisterOffset().regOffset());
+                source.memory = true;
+                return source;
+            }
+            case Operand::Type::MemRegReg: {
+                Source source = compile(operand.getMemoryRegisterRegister().regReg());
+                source.memory = true;
+                return source;
+            }
+            case Operand::Type::MemRegScaled: {
+                Source source = compile(operand.getMemoryRegisterScaled().regScaled());
+                source.memory = true;
+                return source;
+            }
+            case Operand::Type::MemRegImmReg: {
+                Source source = compile(operand.getMemoryRegisterOffsetRegister().regOffsetReg());
+                source.memory = true;
+                return source;
+            }
+            case Operand::Type::MemRegRegScaled: {
+                Source source = compile(operand.getMemoryRegisterRegisterScaled().regRegScaled());
+                source.memory = true;
+                return source;
+            }
+            case Operand::Type::MemRegImmRegScaled: {
+                Source source = compile(operand.getMemoryRegisterOffsetRegisterScaled().regOffsetRegScaled());
+                source.memory = true;
+                return source;
+            }
+        }
+        throw std::runtime_error("Unhandled operand type");
+    }
+
+    FunctionalInterpreter::Op FunctionalInterpreter::compile(const Instruction& instruction) {
+        Op op;
+        auto operands = instruction.signatureOperands();
+        Instruction::Type type = instruction.type();
+        switch (type) {
+            case Instruction::Type::NOP:
+            case Instruction::Type::PREFETCH:
+                // Prefetch has no effect on the values
+                op.kind = Kind::Nop;
+                break;
+            case Instruction::Type::MOV:
+                op.first = compile(operands[1]);
+                if (operands[0].isRegister()) {
+                    op.kind = Kind::Move;
+                    op.target = reg(operands[0].getRegister());
+                } else if (operands[0].isFloatRegister()) {
+                    op.kind = Kind::Move;
+                    op.target = reg(operands[0].getFloatRegister());
+                } else {
+                    op.kind = Kind::Store;
+                    op.second = compile(operands[0]);
+                    op.second.memory = false;
+                }
+                break;
+            case Instruction::Type::LEA:
+                op.kind = Kind::Move;
+                op.target = reg(operands[0].getRegister());
+                op.first = compile(operands[1]);
+                op.first.memory = false;
+                break;
+            case Instruction::Type::CLF:
+                op.kind = Kind::Move;
+                op.target = flags_;
+                op.first = immediate(0);
+                break;
+            case Instruction::Type::ADD:
+            case Instruction::Type::SUB:
+            case Instruction::Type::MUL:
+            case Instruction::Type::DIV:
+            case Instruction::Type::MOD:
+            case Instruction::Type::IMUL:
+            case Instruction::Type::IDIV:
+            case Instruction::Type::AND:
+            case Instruction::Type::OR:
+            case Instruction::Type::XOR:
+            case Instruction::Type::LSH:
+            case Instruction::Type::RSH:
+                // Either dest, reg, val or reg, val with the result going to reg
+                op.kind = Kind::Arithmetic;
+                op.arithmetic = arithmetic(type);
+                op.target = reg(operands[0].getRegister());
+                op.first = compile(operands[operands.size() - 2]);
+                op.second = compile(operands[operands.size() - 1]);
+                break;
+            case Instruction::Type::INC:
+            case Instruction::Type::DEC:
+            case Instruction::Type::NEG:
+            case Instruction::Type::NOT:
+                op.kind = Kind::Arithmetic;
+                op.arithmetic = arithmetic(type);
+                op.target = reg(operands[0].getRegister());
+                op.first = compile(operands[0]);
+                op.second = immediate(1);
+                break;
+            case Instruction::Type::CMP:
+                op.kind = Kind::Arithmetic;
+                op.arithmetic = arithmetic(type);
+                op.first = compile(operands[0]);
+                op.second = compile(operands[1]);
+                break;
+            case Instruction::Type::FADD:
+            case Instruction::Type::FSUB:
+            case Instruction::Type::FMUL:
+            case Instruction::Type::FDIV:
+                op.kind = Kind::FloatArithmetic;
+                op.floatArithmetic = floatArithmetic(type);
+                op.target = reg(operands[0].getFloatRegister());
+                op.first = compile(operands[0]);
+                op.second = compile(operands[1]);
+                break;
+            case Instruction::Type::FCMP:
+                op.kind = Kind::FloatArithmetic;
+                op.floatArithmetic = floatArithmetic(type);
+                op.first = compile(operands[0]);
+                op.second = compile(operands[1]);
+                break;
+            case Instruction::Type::EXT:
+                op.kind = Kind::Extend;
+                op.target = reg(operands[0].getFloatRegister());
+                op.first = compile(operands[1]);
+                break;
+            case Instruction::Type::NRW:
+                op.kind = Kind::Narrow;
+                op.target = reg(operands[0].getRegister());
+                op.first = compile(operands[1]);
+                break;
+            case Instruction::Type::JMP:
+            case Instruction::Type::JZ:
+            case Instruction::Type::JNZ:
+            case Instruction::Type::JE:
+            case Instruction::Type::JNE:
+            case Instruction::Type::JG:
+            case Instruction::Type::JGE:
+            case Instruction::Type::JL:
+            case Instruction::Type::JLE:
+            case Instruction::Type::JA:
+            case Instruction::Type::JAE:
+            case Instruction::Type::JB:
+            case Instruction::Type::JBE:
+            case Instruction::Type::JO:
+            case Instruction::Type::JNO:
+            case Instruction::Type::JS:
+            case Instruction::Type::JNS:
+                op.kind = Kind::Jump;
+                op.condition = jumpCondition(type);
+                op.first = compile(operands[0]);
+                break;
+            case Instruction::Type::LOOP:
+                op.kind = Kind::Loop;
+                op.target = reg(operands[0].getRegister());
+                op.first = compile(operands[1]);
+                break;
+            case Instruction::Type::CALL:
+                op.kind = Kind::Call;
+                op.first = compile(operands[0]);
+                break;
+            case Instruction::Type::RET:
+                op.kind = Kind::Return;
+                break;
+            case Instruction::Type::PUSH:
+            case Instruction::Type::FPUSH:
+                op.kind = Kind::Push;
+                op.first = compile(operands[0]);
+                break;
+            case Instruction::Type::POP:
+                op.kind = Kind::Pop;
+                op.target = reg(operands[0].getRegister());
+                break;
+            case Instruction::Type::FPOP:
+                op.kind = Kind::Pop;
+                op.target = reg(operands[0].getFloatRegister());
+                break;
+            case Instruction::Type::HALT:
+            case Instruction::Type::DBG:
+            case Instruction::Type::BREAK:
+            case Instruction::Type::PUTCHAR:
+            case Instruction::Type::PUTNUM:
+            case Instruction::Type::GETCHAR:
+                op.kind = Kind::Generic;
+                break;
+        }
+        return op;
+    }
+}
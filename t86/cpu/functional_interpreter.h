@@ -0,0 +1,106 @@
+#pragma once
+
+#include "alu.h"
+#include "functional_context.h"
+#include "../instruction.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace tiny::t86 {
+    class Cpu;
+
+    class DecodedProgram;
+
+    /**
+     * Runs the functional mode straight over the registers and memory of the cpu.
+     * Instructions are compiled once when the program is loaded into flat records, where every operand
+     * is a pointer to the register value, so a step does no operand fetching and no product bookkeeping.
+     * Instructions that need their own state, the input and output, HALT, DBG and BREAK, go through FunctionalContext.
+     * Compiled records point into the register file, the registers must not be renamed while the program runs.
+     */
+    class FunctionalInterpreter {
+    public:
+        explicit FunctionalInterpreter(Cpu& cpu);
+
+        /// Compiles the instructions of the program, the cpu must have the program loaded already
+        void load(const DecodedProgram& program);
+
+        /// Executes and retires the instruction Pc points to
+        void step();
+
+    private:
+        /// Any operand is base + offset + index * scale, read from memory when it is a memory operand
+        /// Missing registers point to a zero, immediates are just the offset, floats are their bits
+        struct Source {
+            const int64_t* base{nullptr};
+            const int64_t* index{nullptr};
+            int64_t offset{0};
+            int64_t scale{0};
+            bool memory{false};
+        };
+
+        enum class Kind {
+            Nop,
+            // Target = first
+            Move,
+            // [second] = first
+            Store,
+            // Target and flags from arithmetic of first and second, only the flags if there is no target
+            Arithmetic,
+            FloatArithmetic,
+            // Target = first converted from integer to float
+            Extend,
+            // Target = first converted from float to integer
+            Narrow,
+            // Pc = first if the condition holds for the flags
+            Jump,
+            // Target is decremented, Pc = first if it did not reach zero
+            Loop,
+            Call,
+            Return,
+            Push,
+            Pop,
+            // Executed by the instruction itself through FunctionalContext
+            Generic,
+        };
+
+        struct Op {
+            Kind kind{Kind::Nop};
+            int64_t* target{nullptr};
+            Source first;
+            Source second;
+            Alu::Result (*arithmetic)(int64_t, int64_t){nullptr};
+            Alu::FloatResult (*floatArithmetic)(double, double){nullptr};
+            bool (*condition)(Alu::Flags){nullptr};
+        };
+
+        Op compile(const Instruction& instruction);
+
+        Source compile(const Operand& operand);
+
+        Source immediate(int64_t value) const;
+
+        int64_t* reg(Register reg);
+
+        int64_t* reg(FloatRegister fReg);
+
+        int64_t read(const Source& source) const;
+
+        Cpu& cpu_;
+
+        const DecodedProgram* program_{nullptr};
+
+        // Compiled instructions, the last one is the NOP past the end of the program
+        std::vector<Op> ops_;
+
+        int64_t* pc_{nullptr};
+        int64_t* sp_{nullptr};
+        int64_t* flags_{nullptr};
+
+        // What missing registers of a source point to
+        const int64_t zero_{0};
+
+        FunctionalContext context_;
+    };
+}
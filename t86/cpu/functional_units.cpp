@@ -0,0 +1,115 @@
+#include "functional_units.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "../../common/helpers.h"
+
+namespace tiny::t86 {
+    const char* FunctionalUnits::kindName(Kind kind) {
+        switch (kind) {
+            case Kind::IntegerAlu:
+                return "intAlu";
+            case Kind::MulDiv:
+                return "mulDiv";
+            case Kind::FloatAdd:
+                return "fpAdd";
+            case Kind::FloatMulDiv:
+                return "fpMulDiv";
+            case Kind::LoadStore:
+                return "loadStore";
+            case Kind::Branch:
+                return "branch";
+        }
+        assert(false && "Unknown functional unit kind");
+        return "";
+    }
+
+    FunctionalUnits::FunctionalUnits(std::size_t aluCnt) : typed_(false) {
+        pools_.push_back({"alu", 0, 0, std::vector<std::size_t>(aluCnt, 0)});
+    }
+
+    FunctionalUnits::FunctionalUnits(const std::array<PoolConfig, kindCnt>& pools) : typed_(true) {
+        for (std::size_t i = 0; i < kindCnt; ++i) {
+            if (pools[i].count == 0) {
+                throw std::runtime_error(utils::format("There must be at least one {} unit", kindName(static_cast<Kind>(i))));
+            }
+            pools_.push_back({kindName(static_cast<Kind>(i)), pools[i].latency, pools[i].issueInterval,
+                              std::vector<std::size_t>(pools[i].count, 0)});
+        }
+    }
+
+    std::size_t FunctionalUnits::poolOf(const Instruction* instruction, bool accessesMemory) const {
+        if (!typed_) {
+            return instruction->needsAlu() ? 0 : none;
+        }
+        Kind kind;
+        switch (instruction->type()) {
+            case Instruction::Type::MUL:
+            case Instruction::Type::IMUL:
+            case Instruction::Type::DIV:
+            case Instruction::Type::IDIV:
+            case Instruction::Type::MOD:
+                kind = Kind::MulDiv;
+                break;
+            case Instruction::Type::FADD:
+            case Instruction::Type::FSUB:
+            case Instruction::Type::FCMP:
+            case Instruction::Type::EXT:
+            case Instruction::Type::NRW:
+                kind = Kind::FloatAdd;
+                break;
+            case Instruction::Type::FMUL:
+            case Instruction::Type::FDIV:
+                kind = Kind::FloatMulDiv;
+                break;
+            case Instruction::Type::PREFETCH:
+                kind = Kind::LoadStore;
+                break;
+            case Instruction::Type::LEA:
+                // Address is computed on an alu
+                kind = Kind::IntegerAlu;
+                break;
+            default:
+                if (dynamic_cast<const JumpInstruction*>(instruction)) {
+                    kind = Kind::Branch;
+                } else if (instruction->needsAlu()) {
+                    kind = Kind::IntegerAlu;
+                } else if (accessesMemory) {
+                    kind = Kind::LoadStore;
+                } else {
+                    return none;
+                }
+        }
+        return static_cast<std::size_t>(kind);
+    }
+
+    std::optional<std::size_t> FunctionalUnits::issue(std::size_t pool, std::size_t tick, std::size_t executionTicks) {
+        auto& p = pools_[pool];
+        for (std::size_t unit = 0; unit < p.freeAt.size(); ++unit) {
+            if (p.freeAt[unit] <= tick) {
+                p.freeAt[unit] = tick + (p.issueInterval ? p.issueInterval : executionTicks);
+                return unit;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void FunctionalUnits::release(std::size_t pool, std::size_t unit, std::size_t tick) {
+        auto& freeAt = pools_[pool].freeAt[unit];
+        freeAt = std::min(freeAt, tick);
+    }
+
+    std::optional<std::size_t> FunctionalUnits::nextFreeTick(std::size_t tick) const {
+        std::optional<std::size_t> next;
+        for (const auto& pool : pools_) {
+            for (std::size_t freeAt : pool.freeAt) {
+                if (freeAt > tick && (!next || freeAt < *next)) {
+                    next = freeAt;
+                }
+            }
+        }
+        return next;
+    }
+}
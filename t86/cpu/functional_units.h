@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../instruction.h"
+
+namespace tiny::t86 {
+    /**
+     * Pools of execution units, an instruction needs a free unit of its pool to start executing.
+     * A unit accepts another instruction after the issue interval of its pool,
+     * 1 means fully pipelined, 0 means the unit is busy for the whole execution.
+     * Without typed pools, there is a single pool of alus busy for the whole execution,
+     * used by the instructions that need an alu.
+     */
+    class FunctionalUnits {
+    public:
+        enum class Kind {
+            IntegerAlu, MulDiv, FloatAdd, FloatMulDiv, LoadStore, Branch
+        };
+
+        static constexpr std::size_t kindCnt = 6;
+
+        /// Pool of instructions that need no unit
+        static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+        struct PoolConfig {
+            std::size_t count;
+            // 0 means the execution length of the instruction
+            std::size_t latency;
+            std::size_t issueInterval;
+        };
+
+        /// Name used in the config options and stats
+        static const char* kindName(Kind kind);
+
+        /// Single untyped pool of alus
+        explicit FunctionalUnits(std::size_t aluCnt);
+
+        /// Typed pools, indexed by kind
+        explicit FunctionalUnits(const std::array<PoolConfig, kindCnt>& pools);
+
+        bool typed() const {
+            return typed_;
+        }
+
+        /// Pool the instruction issues to, none if it needs no unit
+        std::size_t poolOf(const Instruction* instruction, bool accessesMemory) const;
+
+        /// Latency the pool forces on its instructions, 0 if they keep their execution length
+        std::size_t latency(std::size_t pool) const {
+            return pools_[pool].latency;
+        }
+
+        const std::string& name(std::size_t pool) const {
+            return pools_[pool].name;
+        }
+
+        /// Takes a unit of the pool that is free in the tick, returns which one
+        std::optional<std::size_t> issue(std::size_t pool, std::size_t tick, std::size_t executionTicks);
+
+        /// Instruction executing on the unit was thrown away, the unit is free right away
+        void release(std::size_t pool, std::size_t unit, std::size_t tick);
+
+        /// First tick after the given one in which some busy unit becomes free
+        std::optional<std::size_t> nextFreeTick(std::size_t tick) const;
+
+    private:
+        struct Pool {
+            std::string name;
+            std::size_t latency;
+            std::size_t issueInterval;
+            // Tick from which each unit accepts another instruction
+            std::vector<std::size_t> freeAt;
+        };
+
+        bool typed_;
+
+        std::vector<Pool> pools_;
+    };
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+#include "branch_predictors/return_address_stack.h"
+
+namespace tiny::t86 {
+    /**
+     * What fetch guessed about a jump, travels with the jump until it retires.
+     * Checkpoints are the speculative state from before the jump was fetched,
+     * they repair the state when the jump turns out to be mispredicted.
+     */
+    struct JumpPrediction {
+        uint64_t destination{0};
+        // Target was found in the branch target buffer
+        bool targetFromBtb{false};
+        // Target was looked up in the branch target buffer, which did not have it
+        bool btbMiss{false};
+        // Target was popped from the return address stack
+        bool targetFromRas{false};
+        uint64_t predictorCheckpoint{0};
+        ReturnAddressStack::Checkpoint returnAddressStackCheckpoint;
+    };
+}
@@ -0,0 +1,25 @@
+#include "load_queue.h"
+
+#include <algorithm>
+
+namespace tiny::t86 {
+    bool LoadQueue::add(const Load& load) {
+        auto it = std::find_if(loads_.begin(), loads_.end(), [&load](const Load& l) { return l.entry == load.entry; });
+        if (it != loads_.end()) {
+            *it = load;
+            return false;
+        }
+        loads_.push_back(load);
+        return true;
+    }
+
+    void LoadQueue::remove(const ReservationStation::Entry& entry) {
+        loads_.erase(std::remove_if(loads_.begin(), loads_.end(),
+                                    [&entry](const Load& load) { return load.entry == &entry; }),
+                     loads_.end());
+    }
+
+    void LoadQueue::clear() {
+        loads_.clear();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "memory_write.h"
+#include "reservation_station.h"
+
+namespace tiny::t86 {
+    /**
+     * Loads that read memory while some older store did not know its address yet.
+     * Once such a store learns its address, loads that read the same address too early are found here.
+     * A load stays here until its instruction retires or is thrown away.
+     */
+    class LoadQueue {
+    public:
+        struct Load {
+            ReservationStation::Entry* entry;
+            std::size_t address;
+            // Youngest write older than the load
+            MemoryWrite::Id maxWriteId;
+            // Write the value was forwarded from, 0 if it was read from ram
+            MemoryWrite::Id source;
+        };
+
+        /// Returns false if the load was already here, a load polled again while its read is on its way is updated instead
+        bool add(const Load& load);
+
+        /// Loads the store should have forwarded to, that is younger loads of the same address that got an older value
+        template<typename F>
+        void forEachViolation(MemoryWrite::Id storeId, std::size_t address, F&& f) const {
+            for (const auto& load : loads_) {
+                if (load.address == address && storeId <= load.maxWriteId && load.source < storeId) {
+                    f(load);
+                }
+            }
+        }
+
+        void remove(const ReservationStation::Entry& entry);
+
+        void clear();
+
+        bool empty() const {
+            return loads_.empty();
+        }
+
+    private:
+        std::vector<Load> loads_;
+    };
+}
@@ -8,6 +8,11 @@ namespace tiny::t86 {
         ramWriteId_ = writeId;
     }
 
+    void MemoryWrite::setAddress(std::size_t address) {
+        assert(!hasAddress() && "Trying to specify address of already specified write");
+        address_ = address;
+    }
+
     void MemoryWrite::setValue(uint64_t value) {
         assert(!hasValue() && !isOutgoing());
         value_ = value;
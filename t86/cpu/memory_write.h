@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../../ram.h"
+#include "../ram.h"
 
 #include <utility>
 #include <cstdint>
@@ -11,6 +11,10 @@ namespace tiny::t86 {
     public:
         using Id = std::size_t;
 
+        explicit MemoryWrite(Id id)
+        : id_(id)
+        {}
+
         MemoryWrite(Id id, std::size_t address)
         : id_(id), address_(address)
         {}
@@ -19,12 +23,14 @@ namespace tiny::t86 {
             return id_;
         }
 
-        std::size_t address() const {
-            return address_;
+        bool hasAddress() const {
+            return address_.has_value();
         }
 
-        bool operator<(const MemoryWrite& other) const {
-            return id_ > other.id_;
+        void setAddress(std::size_t address);
+
+        std::size_t address() const {
+            return address_.value();
         }
 
         bool isPending() const {
@@ -53,7 +59,7 @@ namespace tiny::t86 {
     private:
         Id id_;
 
-        std::size_t address_;
+        std::optional<std::size_t> address_;
 
         std::optional<uint64_t> value_;
 
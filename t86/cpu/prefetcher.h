@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace tiny::t86 {
+    class Prefetcher {
+    public:
+        virtual ~Prefetcher() = default;
+
+        // Called when a load first tries to read the address
+        // Returns addresses the load at the pc is likely to read later, they are fetched ahead if the ram has time
+        virtual std::vector<uint64_t> train(uint64_t pc, uint64_t address) = 0;
+    };
+}
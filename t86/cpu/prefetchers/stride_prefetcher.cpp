@@ -0,0 +1,38 @@
+#include "stride_prefetcher.h"
+
+#include <stdexcept>
+
+namespace tiny::t86 {
+    StridePrefetcher::StridePrefetcher(std::size_t tableSize, std::size_t degree, std::size_t distance)
+            : table_(tableSize), degree_(degree), distance_(distance) {
+        if (tableSize == 0 || degree == 0 || distance == 0) {
+            throw std::runtime_error("Stride prefetcher needs a table entry, degree and distance of at least 1");
+        }
+    }
+
+    std::vector<uint64_t> StridePrefetcher::train(uint64_t pc, uint64_t address) {
+        Entry& entry = table_[pc % table_.size()];
+        if (!entry.valid || entry.pc != pc) {
+            entry = Entry{true, pc, address, 0, 0};
+            return {};
+        }
+        int64_t stride = static_cast<int64_t>(address - entry.lastAddress);
+        entry.lastAddress = address;
+        if (stride == entry.stride && stride != 0) {
+            if (entry.confidence < 3) {
+                ++entry.confidence;
+            }
+        } else {
+            entry.stride = stride;
+            entry.confidence = 0;
+        }
+        if (entry.confidence == 0) {
+            return {};
+        }
+        std::vector<uint64_t> addresses;
+        for (std::size_t i = 0; i < degree_; ++i) {
+            addresses.push_back(address + entry.stride * static_cast<int64_t>(distance_ + i));
+        }
+        return addresses;
+    }
+}
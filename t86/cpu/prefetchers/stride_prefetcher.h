@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "../prefetcher.h"
+
+namespace tiny::t86 {
+    /**
+     * Table of the last address and stride of each load, indexed by the pc.
+     * Once a load repeats its stride, degree addresses starting distance strides ahead are prefetched.
+     */
+    class StridePrefetcher : public Prefetcher {
+    public:
+        StridePrefetcher(std::size_t tableSize, std::size_t degree, std::size_t distance);
+
+        std::vector<uint64_t> train(uint64_t pc, uint64_t address) override;
+
+    private:
+        struct Entry {
+            bool valid{false};
+            uint64_t pc{0};
+            uint64_t lastAddress{0};
+            int64_t stride{0};
+            // Times in a row the stride repeated, saturates at 3, prefetches from 1
+            uint8_t confidence{0};
+        };
+
+        std::vector<Entry> table_;
+
+        std::size_t degree_;
+
+        std::size_t distance_;
+    };
+}
@@ -1,104 +1,52 @@
 #include "register_allocation_table.h"
 
-#include <cassert>
 #include <stdexcept>
 
-#include "../cpu.h"
 #include "../../common/helpers.h"
 
 namespace tiny::t86 {
 
-    RegisterAllocationTable::RegisterAllocationTable(Cpu& cpu, std::size_t registerCnt, std::size_t floatRegisterCnt)
-            : cpu_{cpu} {
+    RegisterAllocationTable::RegisterAllocationTable(std::size_t registerCnt, std::size_t floatRegisterCnt)
+            : registerCnt_{registerCnt},
+              floatRegisterCnt_{floatRegisterCnt},
+              table_(registerCnt + floatRegisterCnt + 4, PhysicalRegister{0}) {
         std::size_t i = 0;
-        for (; i < registerCnt; ++i) {
-            table_.insert_or_assign(Register{i}, PhysicalRegister{i});
+        for (; i < registerCnt + floatRegisterCnt; ++i) {
+            table_[i] = PhysicalRegister{i};
         }
-        for (std::size_t j = 0; j < floatRegisterCnt; ++j, ++i) {
-            table_.insert_or_assign(FloatRegister{j}, PhysicalRegister{i});
+        // Special registers, physical register right after the float ones is left unused
+        for (std::size_t j = i; j < table_.size(); ++j) {
+            table_[j] = PhysicalRegister{ ++i };
         }
-        table_.insert_or_assign(Register::ProgramCounter(), PhysicalRegister{ ++i });
-        table_.insert_or_assign(Register::StackPointer(), PhysicalRegister{ ++i });
-        table_.insert_or_assign(Register::StackBasePointer(), PhysicalRegister{ ++i });
-        table_.insert_or_assign(Register::Flags(), PhysicalRegister{ ++i });
-        subscribeToReads();
     }
 
-    RegisterAllocationTable::RegisterAllocationTable(const RegisterAllocationTable& other)
-            : table_{other.table_}, cpu_{other.cpu_} {
-        subscribeToReads();
-    }
-
-    RegisterAllocationTable::RegisterAllocationTable(RegisterAllocationTable&& other)
-            : table_{std::move(other.table_)}, cpu_{other.cpu_} {
-    }
-
-
-    RegisterAllocationTable::~RegisterAllocationTable() {
-        unsubscribeFromReads();
-    }
-
-    void RegisterAllocationTable::subscribeToReads() {
-        for (const auto&[x, physical] : table_) {
-            cpu_.subscribeRegisterRead(physical);
-        }
-    }
-
-    void RegisterAllocationTable::unsubscribeFromReads() {
-        for (const auto&[x, physical] : table_) {
-            cpu_.unsubscribeRegisterRead(physical);
-        }
-    }
-
-    RegisterAllocationTable& RegisterAllocationTable::operator=(const RegisterAllocationTable& other) {
-        assert(&cpu_ == &other.cpu_);
-
-        if (&other == this) {
-            return *this;
+    std::size_t RegisterAllocationTable::index(Register reg) const {
+        if (reg.index() < registerCnt_) {
+            return reg.index();
         }
-
-        unsubscribeFromReads();
-
-        table_ = other.table_;
-
-        subscribeToReads();
-
-        return *this;
-    }
-
-    void RegisterAllocationTable::rename(Register from, PhysicalRegister to) {
-        if (auto it = table_.find(from); it != table_.end()) {
-            cpu_.unsubscribeRegisterRead(it->second);
+        std::size_t specials = registerCnt_ + floatRegisterCnt_;
+        if (reg == Register::ProgramCounter()) {
+            return specials;
+        } else if (reg == Register::StackPointer()) {
+            return specials + 1;
+        } else if (reg == Register::StackBasePointer()) {
+            return specials + 2;
+        } else if (reg == Register::Flags()) {
+            return specials + 3;
         }
-        table_.insert_or_assign(from, to);
-        cpu_.subscribeRegisterRead(to);
+        throw std::out_of_range(utils::format("Didn't find translation mapping for {}, check maximum register count", reg.toString()));
     }
 
-    void RegisterAllocationTable::rename(FloatRegister from, PhysicalRegister to) {
-        if (auto it = table_.find(from); it != table_.end()) {
-            cpu_.unsubscribeRegisterRead(it->second);
-        }
-        table_.insert_or_assign(from, to);
-        cpu_.subscribeRegisterRead(to);
-    }
-
-    PhysicalRegister RegisterAllocationTable::translate(Register reg) const {
-        auto it = table_.find(reg);
-        if(it == table_.end())
-            throw std::out_of_range(utils::format("Didn't find translation mapping for {}, check maximum register count", reg.toString()));
-        return it->second;
-    }
-
-    PhysicalRegister RegisterAllocationTable::translate(FloatRegister fReg) const {
-        auto it = table_.find(fReg);
-        if(it == table_.end())
+    std::size_t RegisterAllocationTable::index(FloatRegister fReg) const {
+        if (fReg.index() >= floatRegisterCnt_) {
             throw std::out_of_range(utils::format("Didn't find translation mapping for {}, check maximum register count", fReg.toString()));
-        return it->second;
+        }
+        return registerCnt_ + fReg.index();
     }
 
-    bool RegisterAllocationTable::isUnmapped(PhysicalRegister reg) const {
-        return std::all_of(table_.begin(), table_.end(), [reg](const auto& mapping) {
-            return mapping.second != reg;
-        });
+    PhysicalRegister RegisterAllocationTable::rename(std::size_t logical, PhysicalRegister to) {
+        PhysicalRegister previous = table_[logical];
+        table_[logical] = to;
+        return previous;
     }
 }
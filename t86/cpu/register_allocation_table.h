@@ -1,43 +1,57 @@
 #pragma once
 
-#include <map>
+#include <vector>
 
 #include "register.h"
 
 namespace tiny::t86 {
-    class Cpu;
-
+    /**
+     * Maps logical registers to physical ones.
+     * The table is dense, logical registers are numbered as follows: normal registers,
+     * float registers and then Pc, Sp, Bp and Flags. Copying it is a plain copy of a vector,
+     * it does not keep the physical registers alive, the cpu takes care of that.
+     */
     class RegisterAllocationTable {
     public:
+        /// One rename done by an instruction, needed to either free the previous register, or undo the rename
+        struct Rename {
+            std::size_t logical;
+            PhysicalRegister current;
+            PhysicalRegister previous;
+        };
+
         // The number of logical registers here is passed so we don't have to worry
         // if cpu's register count is already initialized
-        RegisterAllocationTable(Cpu& cpu, std::size_t registerCnt, std::size_t floatRegisterCnt);
-
-        RegisterAllocationTable(const RegisterAllocationTable& other);
+        RegisterAllocationTable(std::size_t registerCnt, std::size_t floatRegisterCnt);
 
-        RegisterAllocationTable(RegisterAllocationTable&& other);
+        std::size_t size() const {
+            return table_.size();
+        }
 
-        ~RegisterAllocationTable();
+        std::size_t index(Register reg) const;
 
-        RegisterAllocationTable& operator=(const RegisterAllocationTable& other);
+        std::size_t index(FloatRegister fReg) const;
 
-        void rename(Register from, PhysicalRegister to);
+        /// Returns the previous mapping of the logical register
+        PhysicalRegister rename(std::size_t logical, PhysicalRegister to);
 
-        void rename(FloatRegister from, PhysicalRegister to);
+        PhysicalRegister translate(std::size_t logical) const {
+            return table_[logical];
+        }
 
-        PhysicalRegister translate(Register reg) const;
+        PhysicalRegister translate(Register reg) const {
+            return table_[index(reg)];
+        }
 
-        PhysicalRegister translate(FloatRegister fReg) const;
-
-        bool isUnmapped(PhysicalRegister reg) const;
+        PhysicalRegister translate(FloatRegister fReg) const {
+            return table_[index(fReg)];
+        }
 
     protected:
-        void subscribeToReads();
-
-        void unsubscribeFromReads();
+        std::size_t registerCnt_;
 
-        std::map<std::variant<Register, FloatRegister>, PhysicalRegister> table_;
+        std::size_t floatRegisterCnt_;
 
-        Cpu& cpu_;
+        std::vector<PhysicalRegister> table_;
     };
 }
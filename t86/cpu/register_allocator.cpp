@@ -0,0 +1,41 @@
+#include "register_allocator.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace tiny::t86 {
+    RegisterAllocator::RegisterAllocator(std::size_t physicalRegisterCnt, const RegisterAllocationTable& rat)
+            : references_(physicalRegisterCnt, 0) {
+        for (std::size_t i = 0; i < rat.size(); ++i) {
+            std::size_t index = rat.translate(i).index();
+            if (index >= physicalRegisterCnt) {
+                throw std::runtime_error("Physical register count is too small to hold all logical registers");
+            }
+            ++references_[index];
+        }
+        free_.reserve(physicalRegisterCnt);
+        for (std::size_t i = physicalRegisterCnt; i-- > 0;) {
+            if (references_[i] == 0) {
+                free_.emplace_back(i);
+            }
+        }
+    }
+
+    PhysicalRegister RegisterAllocator::allocate() {
+        if (free_.empty()) {
+            throw std::runtime_error("No free register was found, either bug in RAT or small scale for physical registers");
+        }
+        PhysicalRegister reg = free_.back();
+        free_.pop_back();
+        assert(references_[reg.index()] == 0);
+        references_[reg.index()] = 1;
+        return reg;
+    }
+
+    void RegisterAllocator::release(PhysicalRegister reg) {
+        assert(references_[reg.index()]);
+        if (--references_[reg.index()] == 0) {
+            free_.push_back(reg);
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "register.h"
+#include "register_allocation_table.h"
+
+namespace tiny::t86 {
+    /**
+     * Keeps track of which physical registers are in use.
+     * Each register has a reference count, registers with no references are kept in a free list,
+     * so both allocation and release are O(1).
+     */
+    class RegisterAllocator {
+    public:
+        /// Registers mapped by the initial rat start with one reference, the rest is free
+        RegisterAllocator(std::size_t physicalRegisterCnt, const RegisterAllocationTable& rat);
+
+        std::size_t size() const {
+            return references_.size();
+        }
+
+        std::size_t freeCount() const {
+            return free_.size();
+        }
+
+        std::size_t inUse() const {
+            return size() - freeCount();
+        }
+
+        bool hasFree(std::size_t count) const {
+            return free_.size() >= count;
+        }
+
+        /// Returns a free register with one reference
+        PhysicalRegister allocate();
+
+        /// Register goes back to the free list when its last reference is released
+        void release(PhysicalRegister reg);
+
+    private:
+        std::vector<std::size_t> references_;
+
+        // Used as a stack, the lowest index is on top at the start
+        std::vector<PhysicalRegister> free_;
+    };
+}
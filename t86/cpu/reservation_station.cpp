@@ -2,22 +2,44 @@
 #include "../cpu.h"
 #include "../utils/stats_logger.h"
 
+#include <algorithm>
 #include <cassert>
 #include <exception>
 #include <stdexcept>
 
 namespace tiny::t86 {
+    ReservationStation::Entry& ReservationStation::at(std::size_t i) {
+        i += head_;
+        return entries_[i < entries_.size() ? i : i - entries_.size()];
+    }
+
+    std::size_t ReservationStation::indexOf(const Entry& entry) const {
+        return (&entry - entries_.data() + entries_.size() - head_) % entries_.size();
+    }
+
+    bool ReservationStation::olderFirst(const Entry* a, const Entry* b) {
+        return a->sequence_ < b->sequence_;
+    }
+
+    bool ReservationStation::finishesLater(const Entry* a, const Entry* b) {
+        // Entries finishing in the same tick are processed in program order
+        if (a->finishTick() != b->finishTick()) {
+            return a->finishTick() > b->finishTick();
+        }
+        return a->sequence_ > b->sequence_;
+    }
+
     void ReservationStation::executeAndRetire() {
-        // First check finished ones by progressing execution
-        for (auto& entry : entries_) {
-            if (entry.state() == Entry::State::executing) {
-                if (entry.executionTick()) {
-                    // finished
-                    if (entry.instruction()->needsAlu()) {
-                        ++freeAlus_;
-                    }
-                }
-            }
+        ++tick_;
+        active_ = false;
+
+        // First finish the executing ones whose time has come
+        while (!executing_.empty() && executing_.front()->finishTick() == tick_) {
+            active_ = true;
+            std::pop_heap(executing_.begin(), executing_.end(), finishesLater);
+            Entry& entry = *executing_.back();
+            executing_.pop_back();
+            entry.finishExecution();
         }
 
         // List of entries are in order of execution
@@ -26,12 +48,31 @@ namespace tiny::t86 {
         // might lead to erasure of all other instructions in reservation station (invalidating all iterators)
         // Instructions that just ended execution can retire also in this tick
         // but one tick was also "taken" by preparing state
-        while (!entries_.empty()) {
-            if (entries_.front().state() == Entry::State::retiring) {
-                Entry entry = std::move(entries_.front());
-                entries_.pop_front();
+        std::size_t retired = 0;
+        while (size_ != 0) {
+            if (at(0).state() == Entry::State::retiring) {
+                if (retireWidth_ && retired == retireWidth_) {
+                    // Counts the finished entries that have to wait for the next tick
+                    std::size_t waiting = 0;
+                    while (waiting < size_ && at(waiting).state() == Entry::State::retiring) {
+                        ++waiting;
+                    }
+                    StatsLogger::instance().logRetireWidthStall(waiting);
+                    break;
+                }
+                if (at(0).memoryOrderViolated()) {
+                    // Thrown away together with all the younger entries
+                    cpu_.replayLoad();
+                    break;
+                }
+                // The slot is not reused until the next add, so the entry stays valid while retiring
+                Entry& entry = at(0);
+                active_ = true;
+                head_ = head_ + 1 == entries_.size() ? 0 : head_ + 1;
+                --size_;
                 entry.logRetirement();
                 entry.retire();
+                ++retired;
             }
             else {
                 break;
@@ -40,95 +81,171 @@ namespace tiny::t86 {
     }
 
     void ReservationStation::fetchAndStartExecution() {
-        // Loop through the rest and update them
-        for (auto& entry : entries_) {
-            switch (entry.state()) {
-                case Entry::State::preparing: {
-                    entry.logPreparing();
-                    bool fetchStall{false};
-                    for (Operand& operand : entry.operands()) {
-                        // Check if we need to fetch and fetch as much as we can right now
-                        while(!operand.isFetched()) {
-                            // Get the requirement
-                            Requirement requirement = operand.requirement();
-                            if (requirement.isRegisterRead()) {
-                                Register reg = requirement.getRegisterRead();
-                                if (entry.registerAvailable(reg)) {
-                                    operand.supply(entry.getRegister(reg));
-                                } else {
-                                    fetchStall = true;
-                                    entry.logStallRegisterFetch(reg);
-                                    // This following is very hacky, it's here only for better logging
-                                    // This assumes that there are max 2 register in operands
-                                    // We don't really care for memory, the mem will not start fetching until we know the address, that can be made of 2 registers    
-                                    // COPY the operand, not to mess up the real operand
-                                    Operand op = operand;
-                                    // supply dummy value
-                                    op.supply((int64_t)0);
-                                    // Check it still needs another register
-                                    if (!op.isFetched()) {
-                                        Requirement req = op.requirement();
-                                        if (req.isRegisterRead()) {
-                                            // Another register
-                                            Register r = req.getRegisterRead();
-                                            // check if available
-                                            if (!entry.registerAvailable(r)) {
-                                                // We log this one as well
-                                                entry.logStallRegisterFetch(r);
-                                            }
-                                        }
-                                    }
-                                    break;
-                                }
-                            } else if (requirement.isFloatRegisterRead()) {
-                                FloatRegister fReg = requirement.getFloatRegisterRead();
-                                if (entry.floatRegisterAvailable(fReg)) {
-                                    operand.supply(entry.getFloatRegister(fReg));
-                                } else {
-                                    fetchStall = true;
-                                    entry.logStallFloatRegisterFetch(fReg);
-                                    break;
-                                }
-                            } else if (requirement.isMemoryRead()) {
-                                uint64_t address = requirement.getMemoryRead();
-                                auto optMemory = entry.readMemory(address);
-                                if (optMemory.has_value()) {
-                                    operand.supply(optMemory.value());
-                                } else {
-                                    fetchStall = true;
-                                    entry.logStallRAMRead(address);
-                                    break;
+        // Entries that became ready in this tick start executing in the next one, so select goes first
+        selectForExecution();
+
+        // Operand fetching is done in program order, memory reads compete for the ram gates
+        std::sort(preparing_.begin(), preparing_.end(), olderFirst);
+        // Entries polled again are appended behind these
+        std::size_t count = preparing_.size();
+        for (std::size_t i = 0; i < count; ++i) {
+            Entry* entry = preparing_[i];
+            entry->scheduled_ = false;
+            entry->preparedTick_ = tick_;
+            entry->clearStalls();
+            bool fetched = prepare(*entry);
+            entry->logPreparing();
+            if (fetched) {
+                // Check if all operands fetched
+                entry->checkReady();
+                active_ = true;
+            }
+            if (entry->state() == Entry::State::ready) {
+                ready_.push_back(entry);
+            } else {
+                schedulePreparing(*entry);
+            }
+        }
+        preparing_.erase(preparing_.begin(), preparing_.begin() + count);
+
+        if (StatsLogger::instance().loggingEnabled()) {
+            logIdleEntries();
+        }
+    }
+
+    bool ReservationStation::prepare(Entry& entry) {
+        bool fetched = true;
+        for (Operand& operand : entry.operands()) {
+            // Check if we need to fetch and fetch as much as we can right now
+            while(!operand.isFetched()) {
+                // Get the requirement
+                Requirement requirement = operand.requirement();
+                if (requirement.isRegisterRead()) {
+                    Register reg = requirement.getRegisterRead();
+                    if (entry.registerAvailable(reg)) {
+                        operand.supply(entry.getRegister(reg));
+                        active_ = true;
+                    } else {
+                        fetched = false;
+                        entry.stallRegisterFetch(reg);
+                        // This following is very hacky, it's here only for better logging
+                        // This assumes that there are max 2 register in operands
+                        // We don't really care for memory, the mem will not start fetching until we know the address, that can be made of 2 registers
+                        // COPY the operand, not to mess up the real operand
+                        Operand op = operand;
+                        // supply dummy value
+                        op.supply((int64_t)0);
+                        // Check it still needs another register
+                        if (!op.isFetched()) {
+                            Requirement req = op.requirement();
+                            if (req.isRegisterRead()) {
+                                // Another register
+                                Register r = req.getRegisterRead();
+                                // check if available
+                                if (!entry.registerAvailable(r)) {
+                                    // We log this one as well
+                                    entry.stallRegisterFetch(r);
                                 }
-                            } else {
-                                assert(false && "Unhandled requirement type");
                             }
                         }
+                        break;
                     }
-                    if (fetchStall) {
-                        entry.logStallFetch();
+                } else if (requirement.isFloatRegisterRead()) {
+                    FloatRegister fReg = requirement.getFloatRegisterRead();
+                    if (entry.floatRegisterAvailable(fReg)) {
+                        operand.supply(entry.getFloatRegister(fReg));
+                        active_ = true;
+                    } else {
+                        fetched = false;
+                        entry.stallFloatRegisterFetch(fReg);
+                        break;
                     }
-                    // Check if all operands fetched
-                    entry.checkReady();
-                    break;
+                } else if (requirement.isMemoryRead()) {
+                    uint64_t address = requirement.getMemoryRead();
+                    auto optMemory = entry.readMemory(address);
+                    if (optMemory.has_value()) {
+                        operand.supply(optMemory.value());
+                        active_ = true;
+                    } else {
+                        fetched = false;
+                        entry.stallRAMRead(address);
+                        break;
+                    }
+                } else {
+                    assert(false && "Unhandled requirement type");
                 }
-                case Entry::State::ready:
-                    // Check for ALU
-                    if (entry.instruction()->needsAlu()) {
-                        // No ALU is free
-                        if (!freeAlus_) {
-                            entry.logStallALU();
-                            break;
-                        }
-                        --freeAlus_;
+            }
+        }
+        return fetched;
+    }
+
+    void ReservationStation::schedulePreparing(Entry& entry) {
+        assert(entry.state() == Entry::State::preparing);
+        if (entry.stalledOnMemory() || entry.stalls_.empty()) {
+            // Nothing will tell us when memory is ready, it has to be polled
+            if (!entry.scheduled_) {
+                entry.scheduled_ = true;
+                preparing_.push_back(&entry);
+            }
+        } else {
+            entry.waitForRegisters();
+        }
+    }
+
+    void ReservationStation::wakeUp(Entry& entry) {
+        // Slot might have been squashed and reused in the meantime, waking it up again is harmless
+        // Squashed slot that was not reused yet must stay asleep
+        if (indexOf(entry) < size_ && entry.state() == Entry::State::preparing && !entry.scheduled_) {
+            entry.scheduled_ = true;
+            preparing_.push_back(&entry);
+        }
+    }
+
+    void ReservationStation::selectForExecution() {
+        std::sort(ready_.begin(), ready_.end(), olderFirst);
+        std::size_t waiting = 0;
+        for (Entry* entry : ready_) {
+            std::size_t pool = entry->decoded().unit;
+            if (pool != FunctionalUnits::none) {
+                // Units of a pipelined pool take another instruction before the previous one finishes
+                auto unit = units_.issue(pool, tick_, std::max<std::size_t>(entry->remainingExecutionTime_, 1));
+                if (!unit) {
+                    entry->logStallALU();
+                    if (units_.typed()) {
+                        StatsLogger::instance().logFunctionalUnitStall(units_.name(pool));
+                    }
+                    ready_[waiting++] = entry;
+                    continue;
+                }
+                entry->unit_ = *unit;
+                if (units_.typed()) {
+                    StatsLogger::instance().logFunctionalUnitIssue(units_.name(pool));
+                }
+            }
+            // Start execution
+            // Again, this will result into one tick spent in "ready" state
+            entry->startExecution(tick_);
+            active_ = true;
+            executing_.push_back(entry);
+            std::push_heap(executing_.begin(), executing_.end(), finishesLater);
+        }
+        ready_.resize(waiting);
+    }
+
+    void ReservationStation::logIdleEntries() {
+        for (std::size_t i = 0; i < size_; ++i) {
+            const auto& entry = at(i);
+            switch (entry.state()) {
+                case Entry::State::preparing:
+                    // Sleeping entries would have stalled on the very same registers
+                    if (entry.preparedTick_ != tick_) {
+                        entry.logPreparing();
                     }
-                    // Start execution
-                    // Again, this will result into one tick spent in "ready" state
-                    entry.startExecution();
-                    // This transition can be interpreted as already executing
-                    [[fallthrough]];
+                    break;
+                case Entry::State::ready:
+                    // Logged by select
+                    break;
                 case Entry::State::executing:
-                    // Nothing to do here, we already processed it before
-                    // Just log here
                     entry.logExecuting();
                     break;
                 case Entry::State::retiring:
@@ -140,124 +257,214 @@ namespace tiny::t86 {
         }
     }
 
-    bool ReservationStation::hasFreeEntry() const {
-        return entries_.size() < maxEntries_;
+    std::optional<std::size_t> ReservationStation::nextEventTick() const {
+        std::optional<std::size_t> next;
+        if (!executing_.empty()) {
+            next = executing_.front()->finishTick();
+        }
+        if (!ready_.empty()) {
+            auto unitFree = units_.nextFreeTick(tick_);
+            if (unitFree && (!next || *unitFree < *next)) {
+                next = unitFree;
+            }
+        }
+        return next;
     }
 
-    ReservationStation::ReservationStation(Cpu& cpu, std::size_t aluCnt, std::size_t maxEntriesCnt)
-            : maxEntries_(maxEntriesCnt), cpu_(cpu), freeAlus_(aluCnt) {}
+    void ReservationStation::skip(std::size_t ticks) {
+        assert(executing_.empty() || executing_.front()->finishTick() > tick_ + ticks);
+        tick_ += ticks;
+    }
 
-    void ReservationStation::add(const Instruction* instruction, std::size_t nextPc, std::size_t loggingId) {
-        assert(entries_.size() < maxEntries_ && "Can't add another entry, max capacity was reached");
-        cpu_.renameRegister(Register::ProgramCounter());
-        cpu_.setRegister(Register::ProgramCounter(), nextPc);
-        RegisterAllocationTable readRat = cpu_.getRat();
-        std::vector<MemoryWrite::Id> memWriteIds;
-        for (const auto& product : instruction->produces()) {
-            if (product.isRegister()) {
-                Register reg = product.getRegister();
-                // We always rename program counter
-                if (reg != Register::ProgramCounter()) {
-                    cpu_.renameRegister(reg);
-                }
-            } else if (product.isFloatRegister()) {
-                FloatRegister fReg = product.getFloatRegister();
-                cpu_.renameFloatRegister(fReg);
-            } else if (product.isMemoryImmediate()) {
-                memWriteIds.push_back(cpu_.registerPendingWrite(product.getMemoryImmediate()));
-            } else if (product.isMemoryRegister()) {
-                memWriteIds.push_back(cpu_.registerPendingWrite());
-            } else {
-                assert(false && "Missing product type");
-            }
+    bool ReservationStation::hasFreeEntry() const {
+        return size_ < entries_.size();
+    }
+
+    ReservationStation::ReservationStation(Cpu& cpu, FunctionalUnits units, std::size_t maxEntriesCnt, std::size_t retireWidth)
+            : cpu_(cpu), units_(std::move(units)), retireWidth_(retireWidth) {
+        entries_.reserve(maxEntriesCnt);
+        for (std::size_t i = 0; i < maxEntriesCnt; ++i) {
+            entries_.emplace_back(cpu);
         }
-        RegisterAllocationTable writeRat = cpu_.getRat();
-        auto& entry = entries_.emplace_back(instruction, cpu_,
-                              std::move(readRat), std::move(writeRat),
-                              std::move(memWriteIds), cpu_.currentMaxWriteId(),
-                              loggingId);
+        preparing_.reserve(maxEntriesCnt);
+        ready_.reserve(maxEntriesCnt);
+        executing_.reserve(maxEntriesCnt);
+    }
+
+    void ReservationStation::add(const DecodedInstruction& decoded, std::size_t nextPc, std::size_t loggingId, const JumpPrediction& prediction) {
+        assert(size_ < entries_.size() && "Can't add another entry, max capacity was reached");
+        auto& entry = at(size_++);
+        entry.dispatch(&decoded, nextPc, loggingId, prediction);
+        entry.sequence_ = nextSequence_++;
+        entry.scheduled_ = false;
+        entry.preparedTick_ = tick_;
 
         // Log as preparing status
         entry.logPreparing();
         // Check if ready (for some instructions that do not have any operands)
         entry.checkReady();
+        if (entry.state() == Entry::State::ready) {
+            ready_.push_back(&entry);
+        } else {
+            schedulePreparing(entry);
+        }
     }
 
     void ReservationStation::clear() {
-        for (const auto& entry : entries_) {
-            if (entry.state() == Entry::State::executing && entry.instruction()->needsAlu()) {
-                ++freeAlus_;
+        for (std::size_t i = 0; i < size_; ++i) {
+            const auto& entry = at(i);
+            if (entry.state() == Entry::State::executing && entry.decoded().unit != FunctionalUnits::none) {
+                units_.release(entry.decoded().unit, entry.unit_, tick_);
             }
             entry.logClearSpeculation();
         }
-        entries_.clear();
+        // Renames must be undone from the youngest entry
+        for (std::size_t i = size_; i-- > 0;) {
+            at(i).undoRenames();
+        }
+        size_ = 0;
+        preparing_.clear();
+        ready_.clear();
+        executing_.clear();
+    }
+
+    std::size_t ReservationStation::squashYoungerThan(const Entry& entry) {
+        std::size_t kept = indexOf(entry) + 1;
+        assert(kept <= size_ && &at(kept - 1) == &entry);
+        for (std::size_t i = kept; i < size_; ++i) {
+            auto& squashed = at(i);
+            if (squashed.state() == Entry::State::executing && squashed.decoded().unit != FunctionalUnits::none) {
+                units_.release(squashed.decoded().unit, squashed.unit_, tick_);
+            }
+            squashed.logClearSpeculation();
+            squashed.releaseRenames();
+            cpu_.removeLoad(squashed);
+        }
+        std::size_t squashed = size_ - kept;
+        size_ = kept;
+        auto younger = [&entry](const Entry* e) { return e->sequence_ > entry.sequence_; };
+        std::erase_if(preparing_, younger);
+        std::erase_if(ready_, younger);
+        std::erase_if(executing_, younger);
+        std::make_heap(executing_.begin(), executing_.end(), finishesLater);
+        return squashed;
+    }
+
+    PhysicalRegister ReservationStation::Entry::translateRead(const DecodedProgram::Source& source) const {
+        auto sources = cpu_.decodedProgram().sources(*decoded_);
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            if (sources[i] == source) {
+                return reads_[i];
+            }
+        }
+        throw std::runtime_error("Instruction reads a register that is not among its operands");
+    }
+
+    PhysicalRegister ReservationStation::Entry::translateWrite(std::size_t logical) const {
+        for (const auto& rename : renames_) {
+            if (rename.logical == logical) {
+                return rename.current;
+            }
+        }
+        throw std::runtime_error("Instruction writes a register that it does not produce");
     }
 
     bool ReservationStation::Entry::registerAvailable(Register reg) const {
-        return cpu_.registerReady(readRat_.translate(reg));
+        return cpu_.registerReady(translateRead(reg));
     }
 
     bool ReservationStation::Entry::floatRegisterAvailable(FloatRegister fReg) const {
-        return cpu_.registerReady(readRat_.translate(fReg));
+        return cpu_.registerReady(translateRead(fReg));
     }
 
     int64_t ReservationStation::Entry::getRegister(Register reg) const {
         assert(registerAvailable(reg));
-        return cpu_.getRegister(readRat_.translate(reg));
+        return cpu_.getRegister(translateRead(reg));
     }
 
     double ReservationStation::Entry::getFloatRegister(FloatRegister fReg) const {
         assert(floatRegisterAvailable(fReg));
-        return cpu_.getFloatRegister(readRat_.translate(fReg));
+        return cpu_.getFloatRegister(translateRead(fReg));
     }
 
     void ReservationStation::Entry::setRegister(Register reg, int64_t val) {
-        assert(reg == Register::ProgramCounter() || !cpu_.registerReady(writeRat_.translate(reg)));
-        cpu_.setRegister(writeRat_.translate(reg), val);
+        PhysicalRegister dest = translateWrite(cpu_.getRat().index(reg));
+        assert(reg == Register::ProgramCounter() || !cpu_.registerReady(dest));
+        // Pc already holds the next instruction, jumps write it only when taken
+        if (reg == Register::ProgramCounter()) {
+            jumpTaken_ = true;
+        }
+        cpu_.setRegister(dest, val);
     }
 
     void ReservationStation::Entry::setFloatRegister(FloatRegister fReg, double val) {
-        cpu_.setRegister(writeRat_.translate(fReg), val);
+        cpu_.setRegister(translateWrite(cpu_.getRat().index(fReg)), val);
     }
 
     uint64_t ReservationStation::Entry::getUpdatedProgramCounter() const {
-        return cpu_.getRegister(writeRat_.translate(Register::ProgramCounter()));
+        return cpu_.getRegister(translateWrite(cpu_.getRat().index(Register::ProgramCounter())));
     }
 
     void ReservationStation::Entry::processJump(bool taken) {
         cpu_.jump(*this, taken);
     }
 
-    void ReservationStation::Entry::setProgramCounter(uint64_t address) {
-        setRegister(Register::ProgramCounter(), address);
-    }
+    ReservationStation::Entry::Entry(Cpu& cpu) : cpu_(cpu) {}
 
-    void ReservationStation::Entry::setFlags(Alu::Flags flags) {
-        setRegister(Register::Flags(), flags);
-    }
+    void ReservationStation::Entry::dispatch(const DecodedInstruction* decoded, std::size_t nextPc, std::size_t loggingId, const JumpPrediction& prediction) {
+        const auto& program = cpu_.decodedProgram();
+        decoded_ = decoded;
+        state_ = State::preparing;
+        remainingExecutionTime_ = decoded->executionLength;
+        loggingId_ = loggingId;
+        pc_ = nextPc - 1;
+        memoryOrderViolated_ = false;
+        trainedAddress_.reset();
+        jumpTaken_ = false;
+        memoryAccessException_ = nullptr;
+        stalls_.clear();
 
-    void ReservationStation::Entry::setStackPointer(uint64_t address) {
-        setRegister(Register::StackPointer(), address);
-    }
+        auto operands = program.operands(*decoded);
+        operands_.assign(operands.begin(), operands.end());
 
-    void ReservationStation::Entry::setStackBasePointer(uint64_t address) {
-        setRegister(Register::StackBasePointer(), address);
-    }
+        renames_.clear();
+        renames_.push_back(cpu_.renameRegister(Register::ProgramCounter()));
+        cpu_.setRegister(Register::ProgramCounter(), nextPc);
+
+        // Sources are translated after renaming Pc, but before renaming the products
+        const auto& rat = cpu_.getRat();
+        reads_.clear();
+        for (const auto& source : program.sources(*decoded)) {
+            reads_.push_back(std::visit([&rat](auto reg) { return rat.translate(reg); }, source));
+        }
+
+        // Only older stores can be predicted, so before registering the own ones
+        storeDependency_ = cpu_.predictStoreDependency(pc_);
+        memWriteIds_.clear();
+        for (const auto& product : program.produces(*decoded)) {
+            if (product.isRegister()) {
+                Register reg = product.getRegister();
+                // We always rename program counter
+                if (reg != Register::ProgramCounter()) {
+                    renames_.push_back(cpu_.renameRegister(reg));
+                }
+            } else if (product.isFloatRegister()) {
+                FloatRegister fReg = product.getFloatRegister();
+                renames_.push_back(cpu_.renameFloatRegister(fReg));
+            } else if (product.isMemoryImmediate()) {
+                memWriteIds_.push_back(cpu_.registerPendingWrite(pc_, product.getMemoryImmediate()));
+            } else if (product.isMemoryRegister()) {
+                memWriteIds_.push_back(cpu_.registerPendingWrite(pc_));
+            } else {
+                assert(false && "Missing product type");
+            }
+        }
+        maxWriteId_ = cpu_.currentMaxWriteId();
 
-    ReservationStation::Entry::Entry(const Instruction* instruction, Cpu& cpu,
-                                     RegisterAllocationTable readRat, RegisterAllocationTable writeRat,
-                                     std::vector<MemoryWrite::Id> memWriteIds,
-                                     MemoryWrite::Id maxWriteId,
-                                     std::size_t loggingId)
-            : instruction_(instruction),
-              operands_(instruction->operands()),
-              readRat_(std::move(readRat)),
-              writeRat_(std::move(writeRat)),
-              memWriteIds_(std::move(memWriteIds)),
-              maxWriteId_(maxWriteId),
-              cpu_(cpu),
-              loggingId_(loggingId) {
-        remainingExecutionTime_ = Cpu::Config::instance().getExecutionLength(instruction);
+        if (decoded->jump) {
+            prediction_ = prediction;
+            ratCheckpoint_ = cpu_.getRat();
+        }
     }
 
     bool ReservationStation::Entry::allOperandsFetched() const {
@@ -265,19 +472,14 @@ namespace tiny::t86 {
                            [](const Operand& operand) { return operand.isFetched(); });
     }
 
-    bool ReservationStation::Entry::executionTick() {
+    void ReservationStation::Entry::finishExecution() {
         assert(state_ == State::executing);
-
-        if (remainingExecutionTime_ != 0) {
-            --remainingExecutionTime_;
+        remainingExecutionTime_ = 0;
+        decoded_->instruction->execute(*this);
+        state_ = State::retiring;
+        if (decoded_->jump) {
+            cpu_.resolveJump(*this);
         }
-        // This is done "two-steps" because some instructions might have zero execution tickCount required
-        if (remainingExecutionTime_ == 0) {
-            instruction_->execute(*this);
-            state_ = State::retiring;
-            return true;
-        }
-        return false;
     }
 
     ReservationStation::Entry::State ReservationStation::Entry::state() const {
@@ -285,12 +487,22 @@ namespace tiny::t86 {
     }
 
     const Instruction* ReservationStation::Entry::instruction() const {
-        return instruction_;
+        return decoded_->instruction;
     }
 
-    void ReservationStation::Entry::startExecution() {
+    const DecodedInstruction& ReservationStation::Entry::decoded() const {
+        return *decoded_;
+    }
+
+    void ReservationStation::Entry::startExecution(std::size_t tick) {
         assert(state_ == State::ready && "Starting execution on instruction that is not in ready state");
         state_ = State::executing;
+        // Even instructions with zero execution length finish in the next tick
+        finishTick_ = tick + std::max<std::size_t>(remainingExecutionTime_, 1);
+    }
+
+    std::size_t ReservationStation::Entry::finishTick() const {
+        return finishTick_;
     }
 
     void ReservationStation::Entry::checkReady() {
@@ -306,7 +518,25 @@ namespace tiny::t86 {
             std::rethrow_exception(memoryAccessException_);
         }
 
-        instruction_->retire(*this);
+        decoded_->instruction->retire(*this);
+
+        cpu_.removeLoad(*this);
+
+        for (const auto& rename : renames_) {
+            cpu_.retireRename(rename);
+        }
+    }
+
+    void ReservationStation::Entry::undoRenames() {
+        for (auto it = renames_.rbegin(); it != renames_.rend(); ++it) {
+            cpu_.undoRename(*it);
+        }
+    }
+
+    void ReservationStation::Entry::releaseRenames() {
+        for (const auto& rename : renames_) {
+            cpu_.releaseRename(rename);
+        }
     }
 
     Cpu& ReservationStation::Entry::cpu() const {
@@ -317,27 +547,31 @@ namespace tiny::t86 {
         cpu_.writeMemory(id);
     }
 
-    const RegisterAllocationTable& ReservationStation::Entry::rat() const {
-        // Returning the write rat, because we moved some registers
-        // Used mostly when fixing branch prediction miss, so we care mainly for the PC
-        return writeRat_;
-    }
-
     void ReservationStation::Entry::unrollSpeculation() {
-        cpu_.unrollSpeculation(writeRat_);
+        cpu_.unrollSpeculation();
     }
 
     std::optional<int64_t> ReservationStation::Entry::readMemory(uint64_t address) {
         try {
-            return cpu_.readMemory(address, maxWriteId_);
+            auto value = cpu_.readMemory(address, maxWriteId_, *this);
+            // After the read, so that prefetches do not take the ram gate the load needs
+            if (trainedAddress_ != address) {
+                trainedAddress_ = address;
+                cpu_.trainPrefetcher(pc_, address);
+            }
+            return value;
         } catch(...) {
             memoryAccessException_ = std::current_exception();
             return {-1};
         }
     }
 
+    void ReservationStation::Entry::prefetch(uint64_t address) {
+        cpu_.prefetchMemory(address);
+    }
+
     void ReservationStation::Entry::specifyWriteAddress(MemoryWrite::Id id, std::size_t address) {
-        cpu_.specifyWriteAddress(id, address);
+        cpu_.specifyWriteAddress(id, address, pc_);
     }
 
     void ReservationStation::Entry::setWriteValue(MemoryWrite::Id id, uint64_t value) {
@@ -352,24 +586,56 @@ namespace tiny::t86 {
         StatsLogger::instance().logExecuting(loggingId_);
     }
 
-    void ReservationStation::Entry::logPreparing() const {
-        StatsLogger::instance().logOperandFetching(loggingId_);
+    void ReservationStation::Entry::clearStalls() {
+        stalls_.clear();
+    }
+
+    void ReservationStation::Entry::stallRegisterFetch(Register reg) {
+        stalls_.push_back({Stall::Kind::Register, reg.index()});
+    }
+
+    void ReservationStation::Entry::stallFloatRegisterFetch(FloatRegister fReg) {
+        stalls_.push_back({Stall::Kind::FloatRegister, fReg.index()});
     }
 
-    void ReservationStation::Entry::logStallFetch() const {
-        StatsLogger::instance().logStallFetch(loggingId_);
+    void ReservationStation::Entry::stallRAMRead(uint64_t address) {
+        stalls_.push_back({Stall::Kind::RAMRead, address});
     }
 
-    void ReservationStation::Entry::logStallRegisterFetch(Register reg) const {
-        StatsLogger::instance().logStallRegisterFetch(loggingId_, reg);
+    bool ReservationStation::Entry::stalledOnMemory() const {
+        return std::any_of(stalls_.begin(), stalls_.end(),
+                           [](const Stall& stall) { return stall.kind == Stall::Kind::RAMRead; });
     }
 
-    void ReservationStation::Entry::logStallFloatRegisterFetch(FloatRegister fReg) const {
-        StatsLogger::instance().logStallFloatRegisterFetch(loggingId_, fReg);
+    void ReservationStation::Entry::waitForRegisters() {
+        for (const auto& stall : stalls_) {
+            if (stall.kind == Stall::Kind::Register) {
+                cpu_.waitForRegister(translateRead(Register{stall.value}), *this);
+            } else if (stall.kind == Stall::Kind::FloatRegister) {
+                cpu_.waitForRegister(translateRead(FloatRegister{stall.value}), *this);
+            }
+        }
     }
 
-    void ReservationStation::Entry::logStallRAMRead(uint64_t address) const {
-        StatsLogger::instance().logStallRAMRead(loggingId_, address);
+    void ReservationStation::Entry::logPreparing() const {
+        auto& logger = StatsLogger::instance();
+        logger.logOperandFetching(loggingId_);
+        for (const auto& stall : stalls_) {
+            switch (stall.kind) {
+                case Stall::Kind::Register:
+                    logger.logStallRegisterFetch(loggingId_, Register{stall.value});
+                    break;
+                case Stall::Kind::FloatRegister:
+                    logger.logStallFloatRegisterFetch(loggingId_, FloatRegister{stall.value});
+                    break;
+                case Stall::Kind::RAMRead:
+                    logger.logStallRAMRead(loggingId_, stall.value);
+                    break;
+            }
+        }
+        if (!stalls_.empty()) {
+            logger.logStallFetch(loggingId_);
+        }
     }
 
     void ReservationStation::Entry::logStallRetirement() const {
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "alu.h"
+#include "functional_units.h"
+#include "execution_context.h"
 #include "../cpu/register.h"
 #include "../cpu/register_allocation_table.h"
-#include "../cpu/memory_writes_manager/memory_write.h"
+#include "../cpu/memory_write.h"
+#include "../cpu/jump_prediction.h"
 #include "../utils/stats_logger.h"
+#include "../program/decoded_program.h"
 
-#include <list>
 #include <vector>
 #include <optional>
 #include <condition_variable>
@@ -21,7 +24,8 @@ namespace tiny::t86 {
 
     class ReservationStation {
     public:
-        ReservationStation(Cpu& cpu, std::size_t aluCnt, std::size_t maxEntriesCnt);
+        /// Retire width of 0 means any number of entries can retire in one tick
+        ReservationStation(Cpu& cpu, FunctionalUnits units, std::size_t maxEntriesCnt, std::size_t retireWidth);
 
 
         // We process executing and possibly finished instructions first
@@ -35,31 +39,96 @@ namespace tiny::t86 {
 
         bool hasFreeEntry() const;
 
-        void add(const Instruction*, std::size_t nextPc, std::size_t loggingId);
+        void add(const DecodedInstruction& decoded, std::size_t nextPc, std::size_t loggingId, const JumpPrediction& prediction);
 
         void clear();
 
         class Entry;
 
+        /// Throws away the entries younger than the given one and returns how many there were
+        /// Their renames are released, but restoring the rat is left to the caller
+        std::size_t squashYoungerThan(const Entry& entry);
+
+        /// Whether any entry made progress in the current tick
+        bool active() const {
+            return active_;
+        }
+
+        std::size_t currentTick() const {
+            return tick_;
+        }
+
+        /// Tick in which the next executing entry finishes, or a unit a ready entry waits for becomes free
+        std::optional<std::size_t> nextEventTick() const;
+
+        const FunctionalUnits& functionalUnits() const {
+            return units_;
+        }
+
+        /// Moves the time forward, no entry may finish in the skipped ticks
+        void skip(std::size_t ticks);
+
+        /// A register the entry waits for became ready, entry will try to fetch its operands again
+        void wakeUp(Entry& entry);
+
     private:
-        std::list<Entry> entries_;
+        // i-th oldest entry
+        Entry& at(std::size_t i);
+
+        // How old the entry in the slot is, entries with index past size are free slots
+        std::size_t indexOf(const Entry& entry) const;
+
+        // Fetches as much operands as it can, returns false if the entry is still waiting for memory
+        bool prepare(Entry& entry);
+
+        // Entry goes to sleep if it waits for registers only, otherwise it is polled again next tick
+        void schedulePreparing(Entry& entry);
+
+        void selectForExecution();
+
+        // Logs entries not touched by any event this tick, only done when logging is enabled
+        void logIdleEntries();
+
+        static bool olderFirst(const Entry* a, const Entry* b);
+
+        static bool finishesLater(const Entry* a, const Entry* b);
+
+        // Circular buffer in order of the program, slots are reused and so is the memory of their vectors
+        std::vector<Entry> entries_;
 
-        const std::size_t maxEntries_;
+        std::size_t head_{0};
+
+        std::size_t size_{0};
 
         Cpu& cpu_;
 
-        std::size_t freeAlus_;
+        FunctionalUnits units_;
+
+        std::size_t retireWidth_;
+
+        std::size_t tick_{0};
+
+        bool active_{false};
+
+        // Each dispatched entry gets a sequence number, used to keep the program order when processing events
+        std::size_t nextSequence_{0};
+
+        // Entries to try fetching operands this tick, either just dispatched, woken up or waiting for memory
+        std::vector<Entry*> preparing_;
+
+        // Entries with all operands fetched, waiting for an ALU
+        std::vector<Entry*> ready_;
+
+        // Heap of executing entries, ordered by the tick they finish
+        std::vector<Entry*> executing_;
     };
 
-    class ReservationStation::Entry {
+    class ReservationStation::Entry : public ExecutionContext {
     public:
-        Entry(const Instruction* instruction,
-              Cpu& cpu,
-              RegisterAllocationTable readRat,
-              RegisterAllocationTable writeRat,
-              std::vector<MemoryWrite::Id> memWriteIds,
-              MemoryWrite::Id maxWriteId,
-              std::size_t loggingId);
+        explicit Entry(Cpu& cpu);
+
+        /// Renames the products of the instruction and fills the entry, the slot might have been used before
+        void dispatch(const DecodedInstruction* decoded, std::size_t nextPc, std::size_t loggingId, const JumpPrediction& prediction);
 
         enum class State {
             preparing, ready, executing, retiring
@@ -67,33 +136,78 @@ namespace tiny::t86 {
 
         State state() const;
 
-        std::vector<Operand>& operands() {
+        std::size_t pc() const {
+            return pc_;
+        }
+
+        /// Store this entry waits for before reading memory, as predicted at dispatch
+        MemoryWrite::Id storeDependency() const {
+            return storeDependency_;
+        }
+
+        /// Entry read memory before an older store to the same address, it has to be replayed
+        void violateMemoryOrder() {
+            memoryOrderViolated_ = true;
+        }
+
+        bool memoryOrderViolated() const {
+            return memoryOrderViolated_;
+        }
+
+        /// Only valid for jumps
+        const JumpPrediction& prediction() const {
+            return prediction_;
+        }
+
+        /// Rat right after the jump was dispatched, only valid for jumps
+        const RegisterAllocationTable& ratCheckpoint() const {
+            return *ratCheckpoint_;
+        }
+
+        /// Whether the executed jump wrote Pc
+        bool jumpTaken() const {
+            return jumpTaken_;
+        }
+
+        MemoryWrite::Id maxWriteId() const {
+            return maxWriteId_;
+        }
+
+        std::vector<Operand>& operands() override {
             return operands_;
         }
 
-        const std::vector<Operand>& operands() const {
+        const std::vector<Operand>& operands() const override {
             return operands_;
         }
 
-        const std::vector<MemoryWrite::Id>& memoryWriteIds() const {
+        const std::vector<MemoryWrite::Id>& memoryWriteIds() const override {
             return memWriteIds_;
         }
 
         void retire();
 
+        // Undoes the renames, entry is thrown away
+        void undoRenames();
+
+        // Releases the registers of the renames, entry is thrown away and the rat is restored from a checkpoint
+        void releaseRenames();
+
         void checkReady();
 
-        void startExecution();
+        void startExecution(std::size_t tick);
 
-        bool executionTick();
+        std::size_t finishTick() const;
+
+        void finishExecution();
 
         const Instruction* instruction() const;
 
-        const RegisterAllocationTable& rat() const;
+        const DecodedInstruction& decoded() const;
 
-        void unrollSpeculation();
+        void unrollSpeculation() override;
 
-        Cpu& cpu() const;
+        Cpu& cpu() const override;
 
         bool registerAvailable(Register reg) const;
 
@@ -103,43 +217,43 @@ namespace tiny::t86 {
 
         double getFloatRegister(FloatRegister fReg) const;
 
-        void setRegister(Register reg, int64_t val);
+        void setRegister(Register reg, int64_t val) override;
 
-        void setFloatRegister(FloatRegister fReg, double val);
+        void setFloatRegister(FloatRegister fReg, double val) override;
 
         uint64_t getUpdatedProgramCounter() const;
 
         std::optional<int64_t> readMemory(uint64_t address);
 
-        void specifyWriteAddress(MemoryWrite::Id id, std::size_t address);
+        void specifyWriteAddress(MemoryWrite::Id id, std::size_t address) override;
 
-        void setWriteValue(MemoryWrite::Id id, uint64_t value);
+        void setWriteValue(MemoryWrite::Id id, uint64_t value) override;
 
-        void writeMemory(MemoryWrite::Id);
+        void writeMemory(MemoryWrite::Id) override;
 
-        void processJump(bool taken);
+        void prefetch(uint64_t address) override;
 
-        void setProgramCounter(uint64_t address);
+        void processJump(bool taken) override;
 
-        void setFlags(Alu::Flags flags);
+        // Stalls of the last operand fetching, they are logged by logPreparing
+        void clearStalls();
 
-        void setStackPointer(uint64_t address);
+        void stallRegisterFetch(Register reg);
 
-        // TODO maybe remove, not really used
-        void setStackBasePointer(uint64_t address);
+        void stallFloatRegisterFetch(FloatRegister fReg);
 
-        // Logging
-        void logClearSpeculation() const;
-
-        void logPreparing() const;
+        void stallRAMRead(uint64_t address);
 
-        void logStallFetch() const;
+        bool stalledOnMemory() const;
 
-        void logStallRegisterFetch(Register reg) const;
+        // Makes the cpu wake this entry up once any register it stalled on is ready
+        void waitForRegisters();
 
-        void logStallFloatRegisterFetch(FloatRegister fReg) const;
+        // Logging
+        void logClearSpeculation() const;
 
-        void logStallRAMRead(uint64_t address) const;
+        // Logs operand fetching along with the stalls
+        void logPreparing() const;
 
         void logStallALU() const;
 
@@ -152,25 +266,70 @@ namespace tiny::t86 {
     private:
         bool allOperandsFetched() const;
 
-        const Instruction* instruction_;
+        PhysicalRegister translateRead(const DecodedProgram::Source& source) const;
+
+        PhysicalRegister translateWrite(std::size_t logical) const;
+
+        const DecodedInstruction* decoded_{nullptr};
 
         std::vector<Operand> operands_;
 
-        RegisterAllocationTable readRat_;
+        // Physical registers of the sources of the decoded instruction, in the same order
+        std::vector<PhysicalRegister> reads_;
 
-        RegisterAllocationTable writeRat_;
+        std::vector<RegisterAllocationTable::Rename> renames_;
 
         std::vector<MemoryWrite::Id> memWriteIds_;
 
-        MemoryWrite::Id maxWriteId_;
+        MemoryWrite::Id maxWriteId_{0};
+
+        std::size_t pc_{0};
+
+        MemoryWrite::Id storeDependency_{0};
+
+        bool memoryOrderViolated_{false};
+
+        // Last address the load trained the prefetcher with, each read trains it once
+        std::optional<uint64_t> trainedAddress_;
+
+        JumpPrediction prediction_;
+
+        // Assigned in place, so its memory is reused by the next jump in this slot
+        std::optional<RegisterAllocationTable> ratCheckpoint_;
+
+        bool jumpTaken_{false};
 
         Cpu& cpu_;
 
         State state_ = State::preparing;
 
-        size_t remainingExecutionTime_;
+        size_t remainingExecutionTime_{0};
+
+        std::size_t finishTick_{0};
+
+        // Unit of its pool the entry executes on
+        std::size_t unit_{0};
+
+        // Scheduling, managed by the reservation station
+        friend class ReservationStation;
+
+        std::size_t sequence_{0};
+
+        bool scheduled_{false};
+
+        std::size_t preparedTick_{0};
+
+        struct Stall {
+            enum class Kind {
+                Register, FloatRegister, RAMRead
+            };
+            Kind kind;
+            std::size_t value;
+        };
+
+        std::vector<Stall> stalls_;
 
-        std::size_t loggingId_;
+        std::size_t loggingId_{0};
 
         std::exception_ptr memoryAccessException_;
     };
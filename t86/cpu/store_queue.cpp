@@ -0,0 +1,142 @@
+#include <cassert>
+#include <algorithm>
+
+#include "store_queue.h"
+
+namespace tiny::t86 {
+
+    MemoryWrite::Id StoreQueue::registerPendingWrite() {
+        MemoryWrite::Id writeId = ++currentId_;
+        writes_.emplace_back(writeId);
+        finished_.push_back(false);
+        ++unspecifiedCount_;
+        return writeId;
+    }
+
+    MemoryWrite::Id StoreQueue::registerPendingWrite(std::size_t address) {
+        MemoryWrite::Id writeId = ++currentId_;
+        writes_.emplace_back(writeId, address);
+        finished_.push_back(false);
+        indexAddress(address);
+        return writeId;
+    }
+
+    void StoreQueue::specifyAddress(MemoryWrite::Id id, std::size_t address) {
+        getWrite(id).setAddress(address);
+        indexAddress(address);
+        --unspecifiedCount_;
+    }
+
+    void StoreQueue::specifyValue(MemoryWrite::Id id, uint64_t value) {
+        getWrite(id).setValue(value);
+    }
+
+    bool StoreQueue::hasUnspecifiedWrites(MemoryWrite::Id maxId) const {
+        if (unspecifiedCount_ == 0 || maxId < firstId()) {
+            return false;
+        }
+        // Outgoing writes always have their address
+        std::size_t last = std::min<std::size_t>(maxId - firstId(), writes_.size() - 1);
+        for (std::size_t i = outgoingCount_; i <= last; ++i) {
+            if (!writes_[i].hasAddress()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool StoreQueue::isUnspecified(MemoryWrite::Id id) const {
+        if (writes_.empty() || id < firstId() || id - firstId() >= writes_.size()) {
+            return false;
+        }
+        return !writes_[id - firstId()].hasAddress();
+    }
+
+    std::optional<MemoryWrite> StoreQueue::previousWrite(std::size_t address, MemoryWrite::Id maxId) const {
+        // Lets check, if there are some pending writes to this address
+        if (addresses_.find(address) == addresses_.end() || maxId < firstId()) {
+            return std::nullopt;
+        }
+        std::size_t last = std::min<std::size_t>(maxId - firstId(), writes_.size() - 1);
+        for (std::size_t i = last + 1; i-- > 0;) {
+            const auto& write = writes_[i];
+            if (!finished_[i] && write.hasAddress() && write.address() == address) {
+                return write;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void StoreQueue::removeFinished(const RAM& ram) {
+        for (std::size_t i = 0; i < outgoingCount_; ++i) {
+            if (!finished_[i] && !ram.pending(writes_[i].writeId())) {
+                finished_[i] = true;
+                unindexAddress(writes_[i].address());
+            }
+        }
+        // Writes can finish out of order, a newer write to the same address ends the older one
+        while (outgoingCount_ != 0 && finished_.front()) {
+            writes_.pop_front();
+            finished_.pop_front();
+            --outgoingCount_;
+        }
+    }
+
+    void StoreQueue::removePending() {
+        while (writes_.size() > outgoingCount_) {
+            popPending();
+        }
+        assert(unspecifiedCount_ == 0);
+        // Ids of the removed writes are reused, so that the ids in the queue stay consecutive
+        // Nobody refers to them anymore, their instructions were thrown away
+        if (!writes_.empty()) {
+            currentId_ = writes_.back().id();
+        }
+    }
+
+    void StoreQueue::removePendingAfter(MemoryWrite::Id id) {
+        while (writes_.size() > outgoingCount_ && writes_.back().id() > id) {
+            popPending();
+        }
+        // Every write up to the id stays, the removed ids are reused
+        assert(currentId_ >= id);
+        currentId_ = id;
+    }
+
+    void StoreQueue::popPending() {
+        const auto& write = writes_.back();
+        if (write.hasAddress()) {
+            unindexAddress(write.address());
+        } else {
+            --unspecifiedCount_;
+        }
+        writes_.pop_back();
+        finished_.pop_back();
+    }
+
+    MemoryWrite& StoreQueue::getWrite(MemoryWrite::Id id) {
+        assert(!writes_.empty() && id >= firstId() && id - firstId() < writes_.size() && "Unknown id");
+        return writes_[id - firstId()];
+    }
+
+    void StoreQueue::startWriting(MemoryWrite::Id id, RAM& ram) {
+        MemoryWrite& write = getWrite(id);
+        assert(write.isPending());
+        assert(write.hasValue());
+        assert(id - firstId() == outgoingCount_ && "Writes are started in program order");
+        write.setWriteId(ram.write(write.address(), write.value()));
+        ++outgoingCount_;
+    }
+
+    void StoreQueue::indexAddress(std::size_t address) {
+        ++addresses_[address];
+    }
+
+    void StoreQueue::unindexAddress(std::size_t address) {
+        auto it = addresses_.find(address);
+        assert(it != addresses_.end());
+        if (--it->second == 0) {
+            addresses_.erase(it);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <unordered_map>
+
+#include "memory_write.h"
+
+namespace tiny::t86 {
+    /**
+     * In-flight memory writes, ordered by age.
+     * A write enters the queue when its instruction is dispatched and leaves it once ram finished writing it.
+     * Ids are consecutive, so a write is found by its offset from the oldest one.
+     * Only addresses with some write in flight are indexed, so nothing grows with the number of distinct addresses.
+     */
+    class StoreQueue {
+    public:
+        MemoryWrite::Id currentMaxWriteId() const {
+            return currentId_;
+        }
+
+        /// Removes finished outgoing writes, only the outgoing ones are checked
+        void removeFinished(const RAM& ram);
+
+        /**
+         * Removes all pending writes
+         * Used when undoing speculation
+         */
+        void removePending();
+
+        /**
+         * Removes pending writes younger than the given id
+         * Used when only the instructions after a mispredicted jump are thrown away
+         */
+        void removePendingAfter(MemoryWrite::Id id);
+
+        /// Register future write, we don't know the address right now
+        MemoryWrite::Id registerPendingWrite();
+
+        /// Register future write, with specific address
+        MemoryWrite::Id registerPendingWrite(std::size_t address);
+
+        /// Specify address to previously registered write without address
+        void specifyAddress(MemoryWrite::Id id, std::size_t address);
+
+        /// Specify value of the write, this does not transitions the write to outgoing state
+        void specifyValue(MemoryWrite::Id id, uint64_t value);
+
+        /// Starts the writing
+        void startWriting(MemoryWrite::Id id, RAM& ram);
+
+        bool hasUnspecifiedWrites(MemoryWrite::Id maxId) const;
+
+        /// Whether the write is in flight and does not know its address yet
+        bool isUnspecified(MemoryWrite::Id id) const;
+
+        /**
+         * Returns the youngest write to the address with id up to maxId
+         * It DOES NOT take into account all writes with unspecified address
+         * Check hasUnspecifiedWrites, unless the read is speculative
+         */
+        std::optional<MemoryWrite> previousWrite(std::size_t address, MemoryWrite::Id maxId) const;
+
+        MemoryWrite& getWrite(MemoryWrite::Id id);
+
+        std::size_t size() const {
+            return writes_.size();
+        }
+
+    private:
+        MemoryWrite::Id firstId() const {
+            return writes_.front().id();
+        }
+
+        void indexAddress(std::size_t address);
+
+        void unindexAddress(std::size_t address);
+
+        // Removes the youngest write, which must not be outgoing
+        void popPending();
+
+        MemoryWrite::Id currentId_{0};
+
+        // Oldest first, finished writes stay until all older ones are finished too
+        std::deque<MemoryWrite> writes_;
+
+        // Whether a write was finished, same indices as writes_
+        std::deque<bool> finished_;
+
+        // Writes older than this one are outgoing or finished
+        std::size_t outgoingCount_{0};
+
+        // Number of writes in the queue that have no address yet
+        std::size_t unspecifiedCount_{0};
+
+        // Number of unfinished writes to each address, addresses with no write in flight are erased
+        std::unordered_map<std::size_t, std::size_t> addresses_;
+    };
+}
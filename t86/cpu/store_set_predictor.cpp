@@ -0,0 +1,61 @@
+#include "store_set_predictor.h"
+
+#include <algorithm>
+
+namespace tiny::t86 {
+    StoreSetPredictor::StoreSetPredictor(std::size_t tableSize)
+            : sets_(tableSize, noSet), lastStores_(tableSize, 0) {}
+
+    std::size_t& StoreSetPredictor::set(std::size_t pc) {
+        return sets_[pc % sets_.size()];
+    }
+
+    std::size_t StoreSetPredictor::set(std::size_t pc) const {
+        return sets_[pc % sets_.size()];
+    }
+
+    MemoryWrite::Id StoreSetPredictor::predict(std::size_t loadPc) const {
+        std::size_t s = set(loadPc);
+        return s == noSet ? 0 : lastStores_[s];
+    }
+
+    void StoreSetPredictor::storeDispatched(std::size_t storePc, MemoryWrite::Id id) {
+        std::size_t s = set(storePc);
+        if (s != noSet) {
+            lastStores_[s] = id;
+        }
+    }
+
+    void StoreSetPredictor::violation(std::size_t loadPc, std::size_t storePc) {
+        std::size_t& loadSet = set(loadPc);
+        std::size_t& storeSet = set(storePc);
+        if (loadSet == noSet && storeSet == noSet) {
+            // New set, numbered by the load's slot so that it is unique
+            loadSet = loadPc % sets_.size();
+            storeSet = loadSet;
+        } else if (loadSet == noSet) {
+            loadSet = storeSet;
+        } else if (storeSet == noSet) {
+            storeSet = loadSet;
+        } else if (loadSet != storeSet) {
+            // Merge, the smaller set wins and takes over every pc of the other one
+            std::size_t merged = std::min(loadSet, storeSet);
+            std::size_t other = std::max(loadSet, storeSet);
+            std::replace(sets_.begin(), sets_.end(), other, merged);
+            lastStores_[merged] = std::max(lastStores_[merged], lastStores_[other]);
+            lastStores_[other] = 0;
+        }
+    }
+
+    void StoreSetPredictor::clearInFlight() {
+        std::fill(lastStores_.begin(), lastStores_.end(), 0);
+    }
+
+    void StoreSetPredictor::clearInFlightAfter(MemoryWrite::Id id) {
+        for (auto& store : lastStores_) {
+            if (store > id) {
+                store = 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "memory_write.h"
+
+namespace tiny::t86 {
+    /**
+     * Predicts on which store a load depends, so that it does not read memory speculatively past it.
+     * Loads and stores that once violated memory order are put to the same store set,
+     * a load then waits for the last dispatched store of its set.
+     * Both tables are indexed by the pc, pcs sharing a slot share the set.
+     * Merging two sets relabels all the pcs of one of them, the table is scanned only on a violation.
+     */
+    class StoreSetPredictor {
+    public:
+        explicit StoreSetPredictor(std::size_t tableSize = 1024);
+
+        /// Last dispatched store of the load's store set, 0 if there is none
+        MemoryWrite::Id predict(std::size_t loadPc) const;
+
+        void storeDispatched(std::size_t storePc, MemoryWrite::Id id);
+
+        /// The load read memory before the older store wrote to the same address
+        void violation(std::size_t loadPc, std::size_t storePc);
+
+        /// All in-flight stores were thrown away
+        void clearInFlight();
+
+        /// Only the stores younger than the id were thrown away, older ones are still in flight
+        void clearInFlightAfter(MemoryWrite::Id id);
+
+    private:
+        static constexpr std::size_t noSet = static_cast<std::size_t>(-1);
+
+        std::size_t& set(std::size_t pc);
+
+        std::size_t set(std::size_t pc) const;
+
+        // Store set of each pc
+        std::vector<std::size_t> sets_;
+
+        // Last dispatched store of each set
+        std::vector<MemoryWrite::Id> lastStores_;
+    };
+}
@@ -132,6 +132,8 @@ namespace tiny::t86 {
                 return "EXT";
             case Type::NRW:
                 return "NRW";
+            case Type::PREFETCH:
+                return "PREFETCH";
         }
         throw std::runtime_error("Unhandled instruction type");
     }
@@ -196,12 +198,12 @@ namespace tiny::t86 {
         }
     }
 
-    void BinaryArithmeticInstruction::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void BinaryArithmeticInstruction::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
         Alu::Result binOpRes = op_(operands[0].getValue(), operands[1].getValue());
-        entry.setRegister(dest_, binOpRes.value);
-        entry.setFlags(binOpRes.flags);
+        context.setRegister(dest_, binOpRes.value);
+        context.setFlags(binOpRes.flags);
     }
 
 #define BINARY_ARITH_INS_IMPL(INS_NAME, OP)                                                                     \
@@ -250,12 +252,12 @@ namespace tiny::t86 {
         }
     }
 
-    void FloatBinaryArithmeticInstruction::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void FloatBinaryArithmeticInstruction::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
         Alu::FloatResult binOpRes = op_(operands[0].getFloatValue(), operands[1].getFloatValue());
-        entry.setFloatRegister(fReg_, binOpRes.value);
-        entry.setFlags(binOpRes.flags);
+        context.setFloatRegister(fReg_, binOpRes.value);
+        context.setFlags(binOpRes.flags);
     }
 
 #define FLOAT_BINARY_ARITH_INS_IMPL(INS_NAME, OP)                                                        \
@@ -274,12 +276,12 @@ namespace tiny::t86 {
         }
     }
 
-    void UnaryArithmeticInstruction::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void UnaryArithmeticInstruction::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 1);
         Alu::Result res = op_(operands[0].getValue());
-        entry.setRegister(reg_, res.value);
-        entry.setFlags(res.flags);
+        context.setRegister(reg_, res.value);
+        context.setFlags(res.flags);
     }
 
 #define UNARY_ARITH_INS_IMPL(INS_NAME, OP)                                                           \
@@ -325,16 +327,16 @@ namespace tiny::t86 {
         throw std::runtime_error("Unhandled destination type");
     }
 
-    void MOV::retire(ReservationStation::Entry& entry) const {
+    void MOV::retire(ExecutionContext& context) const {
         // Register write is already taken care of in execute function
         // no need to take care of it here
         if (destination_.isRegister() || destination_.isFloatRegister()) {
             return;
         } else {
         // Make sure memory write happens
-        const auto& memoryWriteIds = entry.memoryWriteIds();
+        const auto& memoryWriteIds = context.memoryWriteIds();
         assert(memoryWriteIds.size() == 1);
-        entry.writeMemory(memoryWriteIds[0]);
+        context.writeMemory(memoryWriteIds[0]);
         }
     }
 
@@ -363,22 +365,22 @@ namespace tiny::t86 {
         }
     }
 
-    void MOV::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void MOV::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(!operands.empty());
         if (destination_.isRegister()) {
             assert(operands.size() == 1);
-            entry.setRegister(destination_.getRegister(), operands[0].getValue());
+            context.setRegister(destination_.getRegister(), operands[0].getValue());
         } else if (destination_.isFloatRegister()) {
             assert(operands.size() == 1);
-            entry.setFloatRegister(destination_.getFloatRegister(), operands[0].getFloatValue());
+            context.setFloatRegister(destination_.getFloatRegister(), operands[0].getFloatValue());
         } else if (destination_.isMemoryImmediate()) {
             assert(operands.size() == 1);
-            const auto& memoryWriteIds = entry.memoryWriteIds();
+            const auto& memoryWriteIds = context.memoryWriteIds();
             assert(memoryWriteIds.size() == 1);
-            entry.setWriteValue(memoryWriteIds[0], operands[0].getValue());
+            context.setWriteValue(memoryWriteIds[0], operands[0].getValue());
         } else {
-            const auto& memoryWriteIds = entry.memoryWriteIds();
+            const auto& memoryWriteIds = context.memoryWriteIds();
             assert(memoryWriteIds.size() == 1);
             int64_t address;
             if (destination_.isMemoryRegister()) {
@@ -424,39 +426,39 @@ namespace tiny::t86 {
             else {
                 throw std::runtime_error("Unhandled operand type");
             }
-            entry.specifyWriteAddress(memoryWriteIds[0], address);
-            entry.setWriteValue(memoryWriteIds[0], operands[0].getValue());
+            context.specifyWriteAddress(memoryWriteIds[0], address);
+            context.setWriteValue(memoryWriteIds[0], operands[0].getValue());
         }
     }
 
-    void CLF::retire(ReservationStation::Entry& entry) {
-        entry.setFlags(Alu::Flags{false, false, false, false});
+    void CLF::retire(ExecutionContext& context) {
+        context.setFlags(Alu::Flags{false, false, false, false});
     }
 
-    void ConditionalJumpInstruction::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void ConditionalJumpInstruction::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
-        entry.processJump(condition_(operands[1].getValue()));
+        context.processJump(condition_(operands[1].getValue()));
     }
 
-    void ConditionalJumpInstruction::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void ConditionalJumpInstruction::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
         if (condition_(operands[1].getValue())) {
-            entry.setProgramCounter(operands[0].getValue());
+            context.setProgramCounter(operands[0].getValue());
         }
     }
 
-    void JMP::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void JMP::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 1);
-        entry.processJump(true);
+        context.processJump(true);
     }
 
-    void JMP::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void JMP::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 1);
-        entry.setProgramCounter(operands[0].getValue());
+        context.setProgramCounter(operands[0].getValue());
     }
 
 #define COND_JMP_INS_IMPL(INS_NAME, CONDITION) \
@@ -499,73 +501,73 @@ INS_NAME::INS_NAME(Operand address) : ConditionalJumpInstruction([](Alu::Flags f
 
     COND_JMP_INS_IMPL(JNS, !flags.signFlag)
 
-    void CMP::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void CMP::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
         Alu::Result res = Alu::subtract(operands[0].getValue(), operands[1].getValue());
-        entry.setFlags(res.flags);
+        context.setFlags(res.flags);
     }
 
-    void FCMP::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void FCMP::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
         Alu::FloatResult res = Alu::fsubtract(operands[0].getFloatValue(), operands[1].getFloatValue());
-        entry.setFlags(res.flags);
+        context.setFlags(res.flags);
     }
 
-    void LOOP::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void LOOP::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
         Alu::Result res = Alu::subtract(operands[0].getValue(), 1);
-        entry.setRegister(reg_, res.value);
-        entry.setFlags(res.flags);
-        entry.operands().emplace_back(res.value);
+        context.setRegister(reg_, res.value);
+        context.setFlags(res.flags);
+        context.operands().emplace_back(res.value);
         if (res.value != 0) {
-            entry.setProgramCounter(operands[1].getValue());
+            context.setProgramCounter(operands[1].getValue());
         }
     }
 
-    void LOOP::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void LOOP::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 3);
-        entry.processJump(operands[2].getValue() != 0);
+        context.processJump(operands[2].getValue() != 0);
     }
 
-    void PUSH::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
-        const auto& memWriteIds = entry.memoryWriteIds();
+    void PUSH::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
+        const auto& memWriteIds = context.memoryWriteIds();
         assert(operands.size() == 2);
         assert(memWriteIds.size() == 1);
-        entry.specifyWriteAddress(memWriteIds[0], operands[1].getValue() - 1);
-        entry.setWriteValue(memWriteIds[0], operands[0].getValue());
-        entry.setStackPointer(operands[1].getValue() - 1);
+        context.specifyWriteAddress(memWriteIds[0], operands[1].getValue() - 1);
+        context.setWriteValue(memWriteIds[0], operands[0].getValue());
+        context.setStackPointer(operands[1].getValue() - 1);
     }
 
-    void PUSH::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
-        const auto& memWriteIds = entry.memoryWriteIds();
+    void PUSH::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
+        const auto& memWriteIds = context.memoryWriteIds();
         assert(operands.size() == 2);
         assert(memWriteIds.size() == 1);
-        entry.writeMemory(memWriteIds[0]);
+        context.writeMemory(memWriteIds[0]);
     }
 
-    void FPUSH::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
-        const auto& memWriteIds = entry.memoryWriteIds();
+    void FPUSH::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
+        const auto& memWriteIds = context.memoryWriteIds();
         assert(operands.size() == 2);
         assert(memWriteIds.size() == 1);
-        entry.specifyWriteAddress(memWriteIds[0], operands[1].getValue() - 1);
+        context.specifyWriteAddress(memWriteIds[0], operands[1].getValue() - 1);
         double opVal = operands[0].getFloatValue();
-        entry.setWriteValue(memWriteIds[0], *reinterpret_cast<int64_t*>(&opVal));
-        entry.setStackPointer(operands[1].getValue() - 1);
+        context.setWriteValue(memWriteIds[0], *reinterpret_cast<int64_t*>(&opVal));
+        context.setStackPointer(operands[1].getValue() - 1);
     }
 
-    void FPUSH::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
-        const auto& memWriteIds = entry.memoryWriteIds();
+    void FPUSH::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
+        const auto& memWriteIds = context.memoryWriteIds();
         assert(operands.size() == 2);
         assert(memWriteIds.size() == 1);
-        entry.writeMemory(memWriteIds[0]);
+        context.writeMemory(memWriteIds[0]);
     }
 
     void POP::validate() const {
@@ -574,75 +576,75 @@ INS_NAME::INS_NAME(Operand address) : ConditionalJumpInstruction([](Alu::Flags f
         }
     }
 
-    void POP::retire(ReservationStation::Entry&) const {
+    void POP::retire(ExecutionContext&) const {
         // No need to anything here, if we don't overwrite old memory
     }
 
-    void POP::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void POP::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
-        entry.setRegister(reg_, operands[0].getValue());
-        entry.setStackPointer(operands[1].getValue() + 1);
+        context.setRegister(reg_, operands[0].getValue());
+        context.setStackPointer(operands[1].getValue() + 1);
     }
 
-    void FPOP::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void FPOP::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
         int64_t opValue = operands[0].getValue();
-        entry.setFloatRegister(fReg_, *reinterpret_cast<double*>(&opValue));
-        entry.setStackPointer(operands[1].getValue() + 1);
+        context.setFloatRegister(fReg_, *reinterpret_cast<double*>(&opValue));
+        context.setStackPointer(operands[1].getValue() + 1);
     }
 
-    void FPOP::retire(ReservationStation::Entry& entry) const {
+    void FPOP::retire(ExecutionContext& context) const {
         // Nothing to be done here
     }
 
-    void CALL::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
-        const auto& memWriteIds = entry.memoryWriteIds();
+    void CALL::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
+        const auto& memWriteIds = context.memoryWriteIds();
         assert(operands.size() == 3);
         assert(memWriteIds.size() == 1);
-        entry.writeMemory(memWriteIds[0]);
-        entry.processJump(true);
+        context.writeMemory(memWriteIds[0]);
+        context.processJump(true);
     }
 
-    void CALL::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
-        const auto& memWriteIds = entry.memoryWriteIds();
+    void CALL::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
+        const auto& memWriteIds = context.memoryWriteIds();
         assert(operands.size() == 3);
         assert(memWriteIds.size() == 1);
-        entry.setProgramCounter(operands[0].getValue());
-        entry.specifyWriteAddress(memWriteIds[0], operands[2].getValue() - 1);
-        entry.setWriteValue(memWriteIds[0], operands[1].getValue());
-        entry.setStackPointer(operands[2].getValue() - 1);
+        context.setProgramCounter(operands[0].getValue());
+        context.specifyWriteAddress(memWriteIds[0], operands[2].getValue() - 1);
+        context.setWriteValue(memWriteIds[0], operands[1].getValue());
+        context.setStackPointer(operands[2].getValue() - 1);
     }
 
-    void RET::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void RET::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
-        entry.processJump(true);
+        context.processJump(true);
     }
 
-    void RET::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void RET::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 2);
-        entry.setProgramCounter(operands[0].getValue());
-        entry.setStackPointer(operands[1].getValue() + 1);
+        context.setProgramCounter(operands[0].getValue());
+        context.setStackPointer(operands[1].getValue() + 1);
     }
 
-    void DBG::retire(ReservationStation::Entry& entry) const {
-        entry.unrollSpeculation();
-        debugFunction_(entry.cpu());
+    void DBG::retire(ExecutionContext& context) const {
+        context.unrollSpeculation();
+        debugFunction_(context.cpu());
     }
 
-    void BREAK::retire(ReservationStation::Entry& entry) const {
-        entry.unrollSpeculation();
-        entry.cpu().doBreak();
+    void BREAK::retire(ExecutionContext& context) const {
+        context.unrollSpeculation();
+        context.cpu().doBreak();
     }
 
-    void HALT::retire(ReservationStation::Entry& entry) const {
-        entry.unrollSpeculation();
-        entry.cpu().halt();
+    void HALT::retire(ExecutionContext& context) const {
+        context.unrollSpeculation();
+        context.cpu().halt();
     }
 
     void PatchableJumpInstruction::setDestination(uint64_t address) {
@@ -687,8 +689,8 @@ INS_NAME::INS_NAME(Operand address) : ConditionalJumpInstruction([](Alu::Flags f
         throw std::runtime_error("Unhandled operand type");
     }
 
-    void LEA::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void LEA::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         int64_t address;
         if (mem_.isMemoryRegisterOffset()) {
             assert(operands.size() == 1);
@@ -702,7 +704,7 @@ INS_NAME::INS_NAME(Operand address) : ConditionalJumpInstruction([](Alu::Flags f
             assert(operands.size() == 2);
             address = Operand::supply(
                     Operand::supply(mem_.getMemoryRegisterRegister(), operands[0].getValue()),
-                    operands[2].getValue()
+                    operands[1].getValue()
             ).index();
         }
         else if (mem_.isMemoryRegisterOffsetRegister()) {
@@ -729,38 +731,64 @@ INS_NAME::INS_NAME(Operand address) : ConditionalJumpInstruction([](Alu::Flags f
         else {
             throw std::runtime_error("Unhandled operand type");
         }
-        entry.setRegister(reg_, address);
+        context.setRegister(reg_, address);
+    }
+
+    void PREFETCH::validate() const {
+        if (!mem_.isMemoryImmediate() && !mem_.isMemoryRegister() && !mem_.isMemoryRegisterOffset() && !mem_.isMemoryRegisterRegister() && !mem_.isMemoryRegisterScaled() && !mem_.isMemoryRegisterOffsetRegister() && !mem_.isMemoryRegisterRegisterScaled() && !mem_.isMemoryRegisterOffsetRegisterScaled()) {
+            throw InvalidOperand(mem_);
+        }
+    }
+
+    std::vector<Operand> PREFETCH::operands() const {
+        // Registers of the address in the order they are supplied, without the final memory read
+        std::vector<Operand> registers;
+        Operand address = mem_;
+        while (!address.isMemoryImmediate()) {
+            registers.emplace_back(address.requirement().getRegisterRead());
+            address.supply(int64_t{0});
+        }
+        return registers;
+    }
+
+    void PREFETCH::execute(ExecutionContext& context) const {
+        Operand address = mem_;
+        for (const auto& operand : context.operands()) {
+            address.supply(operand.getValue());
+        }
+        assert(address.isMemoryImmediate());
+        context.prefetch(address.getMemoryImmediate().index());
     }
 
-    void PUTCHAR::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void PUTCHAR::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 1);
         os_ << static_cast<char>(operands[0].getValue()) << std::flush;
     }
 
-    void PUTNUM::retire(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void PUTNUM::retire(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 1);
         os_ << static_cast<int>(operands[0].getValue()) << std::endl;
     }
 
-    void GETCHAR::retire(ReservationStation::Entry& entry) const {
+    void GETCHAR::retire(ExecutionContext& context) const {
         int c = is_.get();
         if (c == std::char_traits<char>::eof())
             c = -1;
-        entry.setRegister(reg_, c);
+        context.setRegister(reg_, c);
     }
 
-    void EXT::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void EXT::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 1);
-        entry.setFloatRegister(fReg_, static_cast<double>(operands[0].getValue()));
+        context.setFloatRegister(fReg_, static_cast<double>(operands[0].getValue()));
     }
 
-    void NRW::execute(ReservationStation::Entry& entry) const {
-        const auto& operands = entry.operands();
+    void NRW::execute(ExecutionContext& context) const {
+        const auto& operands = context.operands();
         assert(operands.size() == 1);
-        entry.setRegister(reg_, static_cast<int64_t>(operands[0].getFloatValue()));
+        context.setRegister(reg_, static_cast<int64_t>(operands[0].getFloatValue()));
     }
 
 } // namespace tiny::t86
@@ -4,7 +4,7 @@
 #include "cpu/alu.h"
 #include "instructions/operand.h"
 #include "instructions/product.h"
-#include "cpu/reservation_station.h"
+#include "cpu/execution_context.h"
 
 #include <cstdint>
 #include <utility>
@@ -81,8 +81,12 @@ namespace tiny::t86 {
             FDIV,
             EXT,
             NRW,
+            PREFETCH,
         };
 
+        // Types are looked up by name over MOV..lastType, a type added past PREFETCH must move this
+        static constexpr Type lastType = Type::PREFETCH;
+
         struct Signature {
             Type type;
             std::vector<Operand::Type> operandTypes;
@@ -106,11 +110,11 @@ namespace tiny::t86 {
 
         virtual void validate() const {}
 
-        virtual void execute(ReservationStation::Entry& entry) const = 0;
+        virtual void execute(ExecutionContext& context) const = 0;
 
         virtual std::vector<Operand> operands() const = 0;
 
-        virtual void retire(ReservationStation::Entry&) const = 0;
+        virtual void retire(ExecutionContext&) const = 0;
 
         virtual std::vector<Product> produces() const = 0;
 
@@ -173,9 +177,9 @@ namespace tiny::t86 {
 
         void validate() const override;
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
         std::vector<Operand> signatureOperands() const override {
             if (riscLike_) {
@@ -267,9 +271,9 @@ namespace tiny::t86 {
 
         void validate() const override;
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
         std::vector<Operand> operands() const override {
             return { fReg_, val_ };
@@ -313,9 +317,9 @@ namespace tiny::t86 {
 
         void validate() const override;
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
         std::vector<Operand> operands() const override {
             return {reg_};
@@ -356,7 +360,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
 
     class NoOpInstruction : public NoAluInstruction {
     public:
-        void execute(ReservationStation::Entry&) const override {}
+        void execute(ExecutionContext&) const override {}
 
         std::vector<Operand> operands() const override {
             return {};
@@ -371,7 +375,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
     public:
         std::size_t length() const override;
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
         Type type() const override { return Type::NOP; }
     };
@@ -380,7 +384,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
     public:
         std::size_t length() const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
         Type type() const override { return Type::HALT; }
     };
@@ -482,7 +486,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return false;
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
         std::vector<Operand> operands() const override;
 
@@ -494,7 +498,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return {Product::fromOperand(destination_)};
         }
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         Operand destination_;
@@ -515,9 +519,9 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return { Register::Flags() };
         }
 
-        void execute(ReservationStation::Entry&) const override {}
+        void execute(ExecutionContext&) const override {}
 
-        void retire(ReservationStation::Entry& entry);
+        void retire(ExecutionContext& context);
     };
 
     class CMP : public Instruction {
@@ -548,7 +552,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
 
         std::size_t length() const override;
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
         std::vector<Operand> operands() const override {
             return { reg_, value_ };
@@ -558,7 +562,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return { Register::Flags() };
         }
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
     private:
         Register reg_;
@@ -579,7 +583,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
 
         std::size_t length() const override;
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
         std::vector<Operand> operands() const override {
             return { fReg_, value_ };
@@ -589,7 +593,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return { Register::Flags() };
         }
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
     private:
         FloatRegister fReg_;
@@ -620,9 +624,9 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return { Memory::Register(Register::StackPointer()), Register::StackPointer() };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         Operand val_;
@@ -652,9 +656,9 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return { Memory::Register(Register::StackPointer()), Register::StackPointer() };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         Operand val_;
@@ -682,9 +686,9 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
 
         void validate() const override;
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         Register reg_;
@@ -710,9 +714,9 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return { fReg_, Register::StackPointer() };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         FloatRegister fReg_;
@@ -724,7 +728,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
 
         std::size_t length() const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
     };
 
     class DBG : public NoOpInstruction {
@@ -736,7 +740,7 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
 
         std::size_t length() const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         std::function<void(Cpu&)> debugFunction_;
@@ -746,6 +750,10 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
     public:
         virtual Operand getDestination() const = 0;
 
+        /// Whether the jump might not be taken
+        virtual bool isConditional() const {
+            return false;
+        }
     };
 
     class PatchableJumpInstruction : public JumpInstruction {
@@ -804,9 +812,13 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return { address_ };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        bool isConditional() const override {
+            return true;
+        }
+
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     protected:
         std::function<bool(Alu::Flags)> condition_;
@@ -826,9 +838,9 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
             return { address_ };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
     };
 
 #define COND_JMP_INS_DECL(INS_NAME)                           \
@@ -888,11 +900,15 @@ class INS_NAME : public ConditionalJumpInstruction {          \
 
         std::size_t length() const override;
 
+        bool isConditional() const override {
+            return true;
+        }
+
         bool needsAlu() const override {
             return true;
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
         std::vector<Operand> operands() const override {
             return { reg_, address_ };
@@ -902,7 +918,7 @@ class INS_NAME : public ConditionalJumpInstruction {          \
             return { reg_, Register::ProgramCounter(), Register::Flags() };
         }
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         Register reg_;
@@ -934,9 +950,9 @@ class INS_NAME : public ConditionalJumpInstruction {          \
                      Memory::Register{Register::StackPointer()} };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
     };
 
     class RET : public JumpInstruction {
@@ -962,9 +978,9 @@ class INS_NAME : public ConditionalJumpInstruction {          \
             return Memory::Register{Register::StackPointer()};
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
     };
 
     class LEA : public Instruction {
@@ -1010,9 +1026,9 @@ class INS_NAME : public ConditionalJumpInstruction {          \
             return { reg_ };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
     private:
         Register reg_;
@@ -1020,6 +1036,58 @@ class INS_NAME : public ConditionalJumpInstruction {          \
 
     };
 
+    /**
+     * Starts bringing the address closer to the cpu, so that a later load finds it sooner.
+     * Only registers of the address are read, memory is not, nothing is produced and nothing can fail.
+     */
+    class PREFETCH : public Instruction {
+    public:
+        PREFETCH(Memory::Immediate mem) : mem_(mem) {}
+
+        PREFETCH(Memory::Register mem) : mem_(mem) {}
+
+        PREFETCH(Memory::RegisterOffset mem) : mem_(mem) {}
+
+        PREFETCH(Memory::RegisterRegister mem) : mem_(mem) {}
+
+        PREFETCH(Memory::RegisterScaled mem) : mem_(mem) {}
+
+        PREFETCH(Memory::RegisterOffsetRegister mem) : mem_(mem) {}
+
+        PREFETCH(Memory::RegisterRegisterScaled mem) : mem_(mem) {}
+
+        PREFETCH(Memory::RegisterOffsetRegisterScaled mem) : mem_(mem) {}
+
+        PREFETCH(Operand mem) : mem_(mem) {}
+
+        Type type() const override { return Type::PREFETCH; }
+
+        std::size_t length() const override;
+
+        bool needsAlu() const override {
+            return false;
+        }
+
+        void validate() const override;
+
+        std::vector<Operand> operands() const override;
+
+        std::vector<Operand> signatureOperands() const override {
+            return { mem_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return {};
+        }
+
+        void execute(ExecutionContext& context) const override;
+
+        void retire(ExecutionContext&) const override {}
+
+    private:
+        Operand mem_;
+    };
+
     class PUTCHAR : public Instruction {
     public:
         PUTCHAR(Register reg, std::ostream& os = std::cout) : reg_(reg), os_(os) {}
@@ -1040,9 +1108,9 @@ class INS_NAME : public ConditionalJumpInstruction {          \
             return {};
         }
 
-        void execute(ReservationStation::Entry&) const override {}
+        void execute(ExecutionContext&) const override {}
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         Register reg_;
@@ -1070,9 +1138,9 @@ class INS_NAME : public ConditionalJumpInstruction {          \
             return {};
         }
 
-        void execute(ReservationStation::Entry&) const override {}
+        void execute(ExecutionContext&) const override {}
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         Register reg_;
@@ -1104,9 +1172,9 @@ class INS_NAME : public ConditionalJumpInstruction {          \
             return { reg_ };
         }
 
-        void execute(ReservationStation::Entry&) const override {}
+        void execute(ExecutionContext&) const override {}
 
-        void retire(ReservationStation::Entry& entry) const override;
+        void retire(ExecutionContext& context) const override;
 
     private:
         Register reg_;
@@ -1138,9 +1206,9 @@ class INS_NAME : public ConditionalJumpInstruction {          \
             return { fReg_ };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
     private:
         FloatRegister fReg_;
@@ -1171,9 +1239,9 @@ class INS_NAME : public ConditionalJumpInstruction {          \
             return { reg_ };
         }
 
-        void execute(ReservationStation::Entry& entry) const override;
+        void execute(ExecutionContext& context) const override;
 
-        void retire(ReservationStation::Entry&) const override {}
+        void retire(ExecutionContext&) const override {}
 
     private:
         Register reg_;
@@ -35,6 +35,9 @@ namespace tiny::t86 {
             FReg, // FR0
         };
 
+        // Types are looked up by name over Imm..lastType, a type added past FReg must move this
+        static constexpr Type lastType = Type::FReg;
+
         static std::string typeToString(Type type);
 
         std::string toString() const;
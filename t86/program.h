@@ -31,6 +31,10 @@ namespace tiny::t86 {
 
         const Instruction* at(size_t index) const;
 
+        size_t size() const {
+            return instructions_.size();
+        }
+
         const std::vector<int64_t>& data() const {
             return data_;
         }
@@ -0,0 +1,74 @@
+#include "decoded_program.h"
+#include "../cpu.h"
+
+namespace tiny::t86 {
+    DecodedProgram::DecodedProgram(const Program& program, const FunctionalUnits& units) : size_(program.size()) {
+        instructions_.reserve(size_ + 1);
+        for (std::size_t i = 0; i < size_; ++i) {
+            add(program.at(i), units);
+        }
+        // Program::at returns the NOP for any index past the end
+        add(program.at(size_), units);
+    }
+
+    void DecodedProgram::add(const Instruction* instruction, const FunctionalUnits& units) {
+        DecodedInstruction decoded{};
+        decoded.instruction = instruction;
+        decoded.jump = dynamic_cast<const JumpInstruction*>(instruction);
+        decoded.type = instruction->type();
+
+        decoded.operandsBegin = operands_.size();
+        decoded.sourcesBegin = sources_.size();
+        sources_.emplace_back(Register::ProgramCounter());
+        bool accessesMemory = false;
+        for (const auto& operand : instruction->operands()) {
+            operands_.push_back(operand);
+            accessesMemory = addSources(operand) || accessesMemory;
+        }
+        decoded.operandsCount = operands_.size() - decoded.operandsBegin;
+        decoded.sourcesCount = sources_.size() - decoded.sourcesBegin;
+
+        decoded.productsBegin = products_.size();
+        decoded.renamesCount = 1;
+        for (const auto& product : instruction->produces()) {
+            if (product.isMemoryImmediate() || product.isMemoryRegister()) {
+                ++decoded.memoryWritesCount;
+                accessesMemory = true;
+            } else if (product.isFloatRegister() || product.getRegister() != Register::ProgramCounter()) {
+                ++decoded.renamesCount;
+            }
+            products_.push_back(product);
+        }
+        decoded.productsCount = products_.size() - decoded.productsBegin;
+
+        decoded.unit = units.poolOf(instruction, accessesMemory);
+        if (decoded.unit != FunctionalUnits::none && units.latency(decoded.unit)) {
+            decoded.executionLength = units.latency(decoded.unit);
+        } else {
+            decoded.executionLength = Cpu::Config::instance().getExecutionLength(instruction);
+        }
+
+        instructions_.push_back(decoded);
+    }
+
+    bool DecodedProgram::addSources(Operand operand) {
+        bool readsMemory = false;
+        // Walk the requirements with dummy values, which registers are read does not depend on them
+        while (!operand.isFetched()) {
+            Requirement requirement = operand.requirement();
+            if (requirement.isRegisterRead()) {
+                if (requirement.getRegisterRead() != Register::ProgramCounter()) {
+                    sources_.emplace_back(requirement.getRegisterRead());
+                }
+                operand.supply(int64_t{0});
+            } else if (requirement.isFloatRegisterRead()) {
+                sources_.emplace_back(requirement.getFloatRegisterRead());
+                operand.supply(0.0);
+            } else {
+                readsMemory = readsMemory || requirement.isMemoryRead();
+                operand.supply(int64_t{0});
+            }
+        }
+        return readsMemory;
+    }
+}
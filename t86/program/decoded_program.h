@@ -0,0 +1,102 @@
+#pragma once
+
+#include "../program.h"
+#include "../instruction.h"
+#include "../cpu/functional_units.h"
+
+#include <cstdint>
+#include <span>
+#include <variant>
+#include <vector>
+
+namespace tiny::t86 {
+    /**
+     * Everything the pipeline needs to know about an instruction, computed once when the program is loaded.
+     * Operands and products are stored in pools of the owning DecodedProgram,
+     * so the records are small and lie next to each other in memory.
+     */
+    struct DecodedInstruction {
+        const Instruction* instruction;
+
+        // Same as instruction if it is a jump, nullptr otherwise
+        const JumpInstruction* jump;
+
+        Instruction::Type type;
+
+        // Pool of functional units the instruction issues to, FunctionalUnits::none if it needs no unit
+        std::size_t unit;
+
+        std::size_t executionLength;
+
+        uint32_t operandsBegin;
+        uint32_t operandsCount;
+
+        uint32_t productsBegin;
+        uint32_t productsCount;
+
+        // Registers read by the operands, Pc is always among them
+        uint32_t sourcesBegin;
+        uint32_t sourcesCount;
+
+        // Number of memory products, that is number of memory write ids the instruction needs
+        uint32_t memoryWritesCount;
+
+        // Number of physical registers needed to rename the products, Pc is always renamed
+        uint32_t renamesCount;
+    };
+
+    class DecodedProgram {
+    public:
+        using Source = std::variant<Register, FloatRegister>;
+
+        DecodedProgram() = default;
+
+        /**
+         * Decodes all instructions of the program
+         * The program must outlive the decoded program, instructions are referenced, not copied
+         */
+        explicit DecodedProgram(const Program& program, const FunctionalUnits& units);
+
+        /// Same as Program::at, past the end there are only NOPs
+        const DecodedInstruction& at(std::size_t index) const {
+            if (index >= size_) {
+                return instructions_.back();
+            }
+            return instructions_[index];
+        }
+
+        /// Number of instructions of the program, without the NOP past the end
+        std::size_t size() const {
+            return size_;
+        }
+
+        std::span<const Operand> operands(const DecodedInstruction& decoded) const {
+            return {operands_.data() + decoded.operandsBegin, decoded.operandsCount};
+        }
+
+        std::span<const Product> produces(const DecodedInstruction& decoded) const {
+            return {products_.data() + decoded.productsBegin, decoded.productsCount};
+        }
+
+        std::span<const Source> sources(const DecodedInstruction& decoded) const {
+            return {sources_.data() + decoded.sourcesBegin, decoded.sourcesCount};
+        }
+
+    private:
+        void add(const Instruction* instruction, const FunctionalUnits& units);
+
+        // Returns whether the operand reads memory
+        bool addSources(Operand operand);
+
+        std::size_t size_{0};
+
+        // One more than size_, the last one is the NOP returned past the end
+        std::vector<DecodedInstruction> instructions_;
+
+        std::vector<Operand> operands_;
+
+        std::vector<Product> products_;
+
+        std::vector<Source> sources_;
+    };
+}
@@ -1,33 +1,133 @@
 #include <cassert>
+#include <stdexcept>
+#include <algorithm>
 
 #include "ram.h"
+#include "utils/stats_logger.h"
 
 namespace tiny::t86 {
 
-    RAM::RAM(std::size_t memSize, std::size_t gatesCnt) : mem_(memSize, 0), gatesCnt_(gatesCnt) {}
+    RAM::RAM(std::size_t memSize, std::size_t gatesCnt, std::size_t readLatency, std::size_t writeLatency)
+            : mem_(memSize, 0), gatesCnt_(gatesCnt), readLatency_(readLatency), writeLatency_(writeLatency), wheel_(8) {}
 
     void RAM::tick() {
+        ++tick_;
+        readsInTick_ = 0;
         // writes and reads "linger" around for one tick after being finished
-        for (auto writeIt = writes_.begin(); writeIt != writes_.end();) {
-            auto& write = writeIt->second;
-            if (write.remainingCnt == 0) {
-                // Remove from the helper lookup map
-                writesById_.erase(write.id);
-                // Remove from this map
-                writeIt = writes_.erase(writeIt);
-            } else {
-                --write.remainingCnt;
-                ++writeIt;
+        auto& bucket = wheel_[tick_ & (wheel_.size() - 1)];
+        active_ = !bucket.empty();
+        for (const auto& event : bucket) {
+            assert(event.expireTick == tick_);
+            expire(event);
+        }
+        bucket.clear();
+
+        // Drop states of writes that are no longer pending
+        while (!writePending_.empty() && !writePending_.front()) {
+            writePending_.pop_front();
+            ++firstTrackedWriteId_;
+        }
+    }
+
+    void RAM::addCache(std::string name, const Cache::Config& config) {
+        caches_.emplace_back(std::move(name), config);
+    }
+
+    void RAM::setBanks(const BankConfig& config) {
+        if (!config.banks || !config.interleave || !config.rowSize) {
+            throw std::runtime_error("Banked RAM needs at least one bank, word of interleave and word in a row");
+        }
+        bankConfig_ = config;
+        banks_.assign(config.banks, Bank{});
+    }
+
+    void RAM::setPorts(std::size_t readPorts, std::size_t writePorts) {
+        readPorts_ = readPorts;
+        writePorts_ = writePorts;
+    }
+
+    std::size_t RAM::accessMemory(std::size_t address, bool write, std::size_t tick) {
+        std::size_t latency = write ? writeLatency(address) : readLatency(address);
+        if (banks_.empty()) {
+            return tick + latency;
+        }
+        std::size_t chunk = address / bankConfig_.interleave;
+        std::size_t bankIndex = chunk % bankConfig_.banks;
+        // Address of the word within its bank
+        std::size_t local = chunk / bankConfig_.banks * bankConfig_.interleave + address % bankConfig_.interleave;
+        std::size_t row = local / bankConfig_.rowSize;
+
+        auto& bank = banks_[bankIndex];
+        std::size_t start = std::max(tick, bank.freeAt);
+        StatsLogger::RowBuffer outcome = StatsLogger::RowBuffer::Hit;
+        if (!bank.openRow) {
+            outcome = StatsLogger::RowBuffer::Empty;
+            latency += bankConfig_.activateLatency;
+        } else if (*bank.openRow != row) {
+            outcome = StatsLogger::RowBuffer::Conflict;
+            latency += bankConfig_.prechargeLatency + bankConfig_.activateLatency;
+        }
+        bank.openRow = row;
+        // The bank serves one access at a time
+        bank.freeAt = start + latency;
+        StatsLogger::instance().logMemoryBankAccess(bankIndex, outcome, start - tick, latency);
+        return start + latency;
+    }
+
+    std::size_t RAM::accessCache(std::size_t level, std::size_t address, bool write, std::size_t tick) {
+        if (level == caches_.size()) {
+            // Lines are always read whole, even for a write
+            return accessMemory(address, false, tick);
+        }
+        auto& cache = caches_[level];
+        if (auto done = cache.lookup(address, write, tick)) {
+            return *done;
+        }
+        std::size_t start = cache.startMiss(tick);
+        std::size_t ready = accessCache(level + 1, address, false, start);
+        if (auto evicted = cache.fill(address, write, tick, ready)) {
+            writeBack(level + 1, *evicted, start);
+        }
+        return ready;
+    }
+
+    void RAM::writeBack(std::size_t level, std::size_t address, std::size_t tick) {
+        // Write backs to the ram are buffered, nobody waits for them, but they keep the bank busy
+        if (level == caches_.size()) {
+            accessMemory(address, true, tick);
+            return;
+        }
+        if (auto evicted = caches_[level].writeBack(address, tick)) {
+            writeBack(level + 1, *evicted, tick);
+        }
+    }
+
+    void RAM::schedule(Event event) {
+        if (event.expireTick - tick_ >= wheel_.size()) {
+            // Grow the wheel so that every bucket holds events of a single tick only
+            std::size_t size = wheel_.size();
+            while (event.expireTick - tick_ >= size) {
+                size *= 2;
+            }
+            std::vector<std::vector<Event>> wheel(size);
+            for (auto& bucket : wheel_) {
+                for (const auto& e : bucket) {
+                    wheel[e.expireTick & (size - 1)].push_back(e);
+                }
             }
+            wheel_ = std::move(wheel);
         }
+        wheel_[event.expireTick & (wheel_.size() - 1)].push_back(event);
+    }
 
-        for (auto readIt = reads_.begin(); readIt != reads_.end();) {
-            auto& read = readIt->second;
-            if (read.remainingCnt == 0) {
-                readIt = reads_.erase(readIt);
-            } else {
-                --read.remainingCnt;
-                ++readIt;
+    void RAM::expire(const Event& event) {
+        if (event.kind == Event::Kind::Read) {
+            reads_.erase(event.address);
+        } else {
+            // The write might have been overwritten by a newer one in the meantime
+            if (auto it = writes_.find(event.address); it != writes_.end() && it->second == event.id) {
+                writes_.erase(it);
+                writePending_[event.id - firstTrackedWriteId_] = false;
             }
         }
     }
@@ -36,7 +136,7 @@ namespace tiny::t86 {
         // Check reads
         if (auto it = reads_.find(address); it != reads_.end()) {
             const auto& read = it->second;
-            if (read.remainingCnt == 0) {
+            if (read.doneTick <= tick_) {
                 // Ready
                 return read.value;
             } else {
@@ -45,30 +145,151 @@ namespace tiny::t86 {
             }
         }
 
+        // Prefetched value needs no gate, the read only waits for the rest of the prefetch
+        if (auto it = std::find_if(prefetched_.begin(), prefetched_.end(),
+                                   [address](const Prefetched& p) { return p.address == address; }); it != prefetched_.end()) {
+            bool late = it->doneTick > tick_;
+            StatsLogger::instance().logMemoryRead();
+            StatsLogger::instance().logPrefetchUse(late);
+            std::size_t doneTick = std::max(it->doneTick, tick_);
+            prefetched_.erase(it);
+            reads_[address] = ReadEntry{doneTick, mem_.at(address)};
+            active_ = true;
+            schedule({Event::Kind::Read, address, doneTick + 1, 0});
+            if (!late) {
+                return reads_[address].value;
+            }
+            return std::nullopt;
+        }
+
         if (!isBusy()) {
             // Start reading
-            assert(reads_.find(address) == reads_.end());
             assert(writes_.find(address) == writes_.end() && "You should not read from address that is being written to");
-            reads_[address] = ReadEntry{readLatency(address), mem_.at(address)};
+            ++readsInTick_;
+            StatsLogger::instance().logMemoryRead();
+            std::size_t doneTick = caches_.empty() ? accessMemory(address, false, tick_) : accessCache(0, address, false, tick_);
+            reads_[address] = ReadEntry{doneTick, mem_.at(address)};
+            active_ = true;
+            schedule({Event::Kind::Read, address, doneTick + 1, 0});
+        } else if (gatesInUse() < gatesCnt_) {
+            StatsLogger::instance().logReadPortStall();
         }
 
         return std::nullopt;
     }
 
+    std::size_t RAM::gatesInUse() const {
+        return reads_.size() + std::count_if(prefetched_.begin(), prefetched_.end(),
+                                             [this](const Prefetched& p) { return p.doneTick > tick_; });
+    }
+
     bool RAM::isBusy() const {
-        return reads_.size() == gatesCnt_;
+        return gatesInUse() >= gatesCnt_ || (readPorts_ && readsInTick_ == readPorts_);
+    }
+
+    void RAM::setPrefetchBufferSize(std::size_t size) {
+        prefetchBufferSize_ = size;
+    }
+
+    bool RAM::prefetch(std::size_t address) {
+        if (address >= mem_.size() || isBusy() || reads_.contains(address) || writes_.contains(address)) {
+            return false;
+        }
+        if (!caches_.empty()) {
+            auto& cache = caches_.front();
+            if (cache.contains(address) || !cache.hasFreeMshr(tick_)) {
+                return false;
+            }
+            std::size_t start = cache.startMiss(tick_);
+            std::size_t ready = accessCache(1, address, false, start);
+            if (auto evicted = cache.fill(address, false, tick_, ready, true)) {
+                writeBack(1, *evicted, start);
+            }
+            active_ = true;
+            return true;
+        }
+        if (prefetchBufferSize_ == 0 || std::any_of(prefetched_.begin(), prefetched_.end(),
+                                                    [address](const Prefetched& p) { return p.address == address; })) {
+            return false;
+        }
+        if (prefetched_.size() == prefetchBufferSize_) {
+            prefetched_.pop_front();
+            StatsLogger::instance().logUselessPrefetch();
+        }
+        prefetched_.push_back({address, accessMemory(address, false, tick_)});
+        active_ = true;
+        return true;
     }
 
     RAM::WriteId RAM::write(std::size_t address, int64_t value) {
         mem_.at(address) = value;
+        active_ = true;
         WriteId id = writeIdCounter++;
         if (auto it = writes_.find(address); it != writes_.end()) {
-            writesById_.erase(it->second.id);
+            writePending_[it->second - firstTrackedWriteId_] = false;
+        }
+        writes_[address] = id;
+        writePending_.push_back(true);
+        // Writes come in program order, so loads that take a value from a read still on its way are younger than this write
+        if (auto it = reads_.find(address); it != reads_.end()) {
+            it->second.value = value;
         }
-        writesById_.insert(std::make_pair(id, std::cref(writes_[address] = WriteEntry{id, writeLatency(address), value})));
+        // Prefetched value is stale now
+        if (auto it = std::find_if(prefetched_.begin(), prefetched_.end(),
+                                   [address](const Prefetched& p) { return p.address == address; }); it != prefetched_.end()) {
+            prefetched_.erase(it);
+            StatsLogger::instance().logUselessPrefetch();
+        }
+        std::size_t start = tick_;
+        if (writePorts_) {
+            if (writePortTick_ < tick_) {
+                writePortTick_ = tick_;
+                writesInPortTick_ = 0;
+            }
+            if (writesInPortTick_ == writePorts_) {
+                ++writePortTick_;
+                writesInPortTick_ = 0;
+            }
+            ++writesInPortTick_;
+            start = writePortTick_;
+            if (start != tick_) {
+                StatsLogger::instance().logWritePortDelay(start - tick_);
+            }
+        }
+        std::size_t doneTick = caches_.empty() ? accessMemory(address, true, start) : accessCache(0, address, true, start);
+        schedule({Event::Kind::Write, address, doneTick + 1, id});
         return id;
     }
 
+    std::optional<std::size_t> RAM::nextEventTick() const {
+        std::optional<std::size_t> next;
+        for (const auto& [address, read] : reads_) {
+            if (read.doneTick > tick_ && (!next || read.doneTick < *next)) {
+                next = read.doneTick;
+            }
+        }
+        // Arriving prefetch frees its gate
+        for (const auto& prefetched : prefetched_) {
+            if (prefetched.doneTick > tick_ && (!next || prefetched.doneTick < *next)) {
+                next = prefetched.doneTick;
+            }
+        }
+        // Every scheduled expiry is less than a wheel turn away
+        for (std::size_t i = 1; i < wheel_.size() && (!next || tick_ + i < *next); ++i) {
+            if (!wheel_[(tick_ + i) & (wheel_.size() - 1)].empty()) {
+                return tick_ + i;
+            }
+        }
+        return next;
+    }
+
+    void RAM::skip(std::size_t ticks) {
+        assert(!nextEventTick() || *nextEventTick() > tick_ + ticks);
+        tick_ += ticks;
+        active_ = false;
+        readsInTick_ = 0;
+    }
+
     int64_t RAM::get(std::size_t address) const {
         return mem_.at(address);
     }
@@ -82,6 +303,6 @@ namespace tiny::t86 {
     }
 
     bool RAM::pending(RAM::WriteId id) const {
-        return writesById_.find(id) != writesById_.end();
+        return id >= firstTrackedWriteId_ && id < writeIdCounter && writePending_[id - firstTrackedWriteId_];
     }
 }
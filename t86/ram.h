@@ -2,27 +2,61 @@
 
 #include <array>
 #include <optional>
-#include <list>
+#include <deque>
 #include <vector>
 #include <cstdint>
 #include <unordered_map>
-#include <functional>
+
+#include "cache.h"
 
 namespace tiny::t86 {
     class RAM {
     public:
         using WriteId = size_t;
 
-        RAM(std::size_t memSize, std::size_t gatesCnt);
+        /// Banked memory, consecutive chunks of interleave words go to consecutive banks
+        /// Each bank keeps its last row open, an access to another row pays for closing and opening rows
+        struct BankConfig {
+            std::size_t banks;
+            std::size_t interleave;
+            // In words of a single bank
+            std::size_t rowSize;
+            std::size_t activateLatency;
+            std::size_t prechargeLatency;
+        };
+
+        RAM(std::size_t memSize, std::size_t gatesCnt, std::size_t readLatency, std::size_t writeLatency);
 
         void tick();
 
+        /// Puts a cache level between the ram and the levels added before it, the first one is closest to the cpu
+        void addCache(std::string name, const Cache::Config& config);
+
+        /// Without banks, every access takes the same time and accesses do not wait for each other
+        void setBanks(const BankConfig& config);
+
+        /// Reads and writes started per tick, 0 means no limit
+        /// A read that finds no port is refused, a write starts in the first tick with a free port
+        void setPorts(std::size_t readPorts, std::size_t writePorts);
+
+        /// Prefetched values wait here for their loads when there are no caches, the oldest one is thrown out first
+        void setPrefetchBufferSize(std::size_t size);
+
+        /// Starts fetching the address ahead of a load, into the first cache or into the prefetch buffer
+        /// Nothing is issued when the address is already there or on its way, or when the ram has no free gate
+        bool prefetch(std::size_t address);
+
         std::size_t readLatency(std::size_t address) const;
 
         std::size_t writeLatency(std::size_t address) const;
 
         std::optional<int64_t> read(std::size_t address);
 
+        /// Whether a read of the address has started, its value was taken when it started
+        bool reading(std::size_t address) const {
+            return reads_.contains(address);
+        }
+
         WriteId write(std::size_t address, int64_t value);
 
         bool isBusy() const;
@@ -31,35 +65,120 @@ namespace tiny::t86 {
 
         bool pending(WriteId id) const;
 
+        std::size_t currentTick() const {
+            return tick_;
+        }
+
+        /// Whether a request started or expired in the current tick
+        bool active() const {
+            return active_;
+        }
+
+        /// Next tick in which a read finishes or a request expires
+        std::optional<std::size_t> nextEventTick() const;
+
+        /// Moves the time forward, no events may fall into the skipped ticks
+        void skip(std::size_t ticks);
+
     public: /// These functions should be used only for debug purposes
         int64_t get(std::size_t address) const;
 
         void set(std::size_t address, int64_t value);
 
     private:
+        // Completion of reads and writes is tracked in a timing wheel, one bucket per tick
+        struct Event {
+            enum class Kind {
+                Read, Write
+            };
+            Kind kind;
+            std::size_t address;
+            // Tick when the request is removed, that is one tick after it finished
+            std::size_t expireTick;
+            WriteId id;
+        };
+
+        void schedule(Event event);
+
+        void expire(const Event& event);
+
+        /// Tick in which an access started in the given tick at the cache level is done, the level past the caches is the ram
+        std::size_t accessCache(std::size_t level, std::size_t address, bool write, std::size_t tick);
+
+        void writeBack(std::size_t level, std::size_t address, std::size_t tick);
+
+        /// Reads and prefetches that have not arrived yet
+        std::size_t gatesInUse() const;
+
+        /// Tick in which an access of the memory itself started in the given tick is done
+        std::size_t accessMemory(std::size_t address, bool write, std::size_t tick);
+
         WriteId writeIdCounter {0};
 
+        // Pending state of writes with id firstTrackedWriteId_ and up, the older ones are no longer pending
+        WriteId firstTrackedWriteId_{0};
+
+        std::deque<bool> writePending_;
+
         // TODO changeable mem size
         std::vector<int64_t> mem_;
         // TODO changeable gates count
         std::size_t gatesCnt_;
 
-        struct ReadEntry {
-            std::size_t remainingCnt;
-            int64_t value;
+        std::size_t readLatency_;
+
+        std::size_t writeLatency_;
+
+        // Without caches, every access pays the ram latency
+        std::vector<Cache> caches_;
+
+        struct Bank {
+            std::optional<std::size_t> openRow;
+            // Tick from which the bank takes another access
+            std::size_t freeAt{0};
         };
 
-        struct WriteEntry {
-            WriteId id;
-            std::size_t remainingCnt;
+        BankConfig bankConfig_{};
+
+        std::vector<Bank> banks_;
+
+        std::size_t readPorts_{0};
+
+        std::size_t writePorts_{0};
+
+        std::size_t readsInTick_{0};
+
+        // Writes are started in program order, so the ports are taken tick by tick
+        std::size_t writePortTick_{0};
+
+        std::size_t writesInPortTick_{0};
+
+        struct Prefetched {
+            std::size_t address;
+            std::size_t doneTick;
+        };
+
+        // Oldest first, used only without caches, a prefetch holds a gate until it arrives
+        std::deque<Prefetched> prefetched_;
+
+        std::size_t prefetchBufferSize_{0};
+
+        struct ReadEntry {
+            // Value can be read from this tick on
+            std::size_t doneTick;
             int64_t value;
         };
 
         std::unordered_map<size_t, ReadEntry> reads_;
 
-        std::unordered_map<size_t, WriteEntry> writes_;
+        // Last write to each address that is still pending
+        std::unordered_map<size_t, WriteId> writes_;
+
+        std::size_t tick_{0};
+
+        bool active_{false};
 
-        // Helper lookup map by id
-        std::unordered_map<WriteId, std::reference_wrapper<const WriteEntry>> writesById_;
+        // Size is always a power of two larger than the longest latency
+        std::vector<std::vector<Event>> wheel_;
     };
 }
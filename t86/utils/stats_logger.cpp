@@ -5,6 +5,7 @@
 #include <iostream>
 #include <cassert>
 #include <unordered_map>
+#include <algorithm>
 
 namespace tiny::t86 {
     StatsLogger& StatsLogger::instance() {
@@ -15,94 +16,286 @@ namespace tiny::t86 {
     void StatsLogger::logInstructionFetch(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        currentTick().instructionFetchPc = id;
+        tickEvents_[id].fetch = true;
+        trace(id, TraceEvent::Kind::Fetch);
+        if (!streaming_) {
+            currentTick().instructionFetchIds.push_back(id);
+        }
     }
 
     void StatsLogger::logInstructionDecode(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        currentTick().instructionDecodePc = id;
+        tickEvents_[id].decode = true;
+        trace(id, TraceEvent::Kind::Decode);
+        if (!streaming_) {
+            currentTick().instructionDecodeIds.push_back(id);
+        }
     }
 
     void StatsLogger::logStallRetirement(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        currentTick().stallRetirementRSEntries.push_back(id);
+        tickEvents_[id].retirementStall = true;
+        trace(id, TraceEvent::Kind::RetirementStall);
+        if (!streaming_) {
+            currentTick().stallRetirementRSEntries.push_back(id);
+        }
     }
 
     void StatsLogger::logNoAluAvailable(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        currentTick().stallNoAluRSEntries.push_back(id);
+        tickEvents_[id].noAlu = true;
+        trace(id, TraceEvent::Kind::NoAlu);
+        if (!streaming_) {
+            currentTick().stallNoAluRSEntries.push_back(id);
+        }
     }
 
     void StatsLogger::logOperandFetching(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        currentTick().operandFetchingRSEntries.push_back(id);
+        tickEvents_[id].operandFetching = true;
+        trace(id, TraceEvent::Kind::OperandFetching);
+        if (!streaming_) {
+            currentTick().operandFetchingRSEntries.push_back(id);
+        }
     }
 
     void StatsLogger::logStallFetch(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        currentTick().operandFetchingStallRSEntries.push_back(id);
+        tickEvents_[id].operandFetchingStall = true;
+        trace(id, TraceEvent::Kind::FetchStall);
+        if (!streaming_) {
+            currentTick().operandFetchingStallRSEntries.push_back(id);
+        }
     }
 
     void StatsLogger::logStallRegisterFetch(std::size_t id, Register reg) {
         if (!loggingEnabled_)
             return;
-        currentTick().stallRegisterFetchRSEntries[id].insert(reg);
+        tickEvents_[id].registerFetchStalls.insert(reg);
+        trace(id, TraceEvent::Kind::RegisterFetchStall, reg.index());
+        if (!streaming_) {
+            currentTick().stallRegisterFetchRSEntries[id].insert(reg);
+        }
     }
 
     void StatsLogger::logStallFloatRegisterFetch(std::size_t id, FloatRegister fReg) {
         if (!loggingEnabled_)
             return;
-        currentTick().stallFloatRegisterFetchRSEntries[id].insert(fReg);
+        tickEvents_[id].floatRegisterFetchStalls.insert(fReg);
+        trace(id, TraceEvent::Kind::FloatRegisterFetchStall, fReg.index());
+        if (!streaming_) {
+            currentTick().stallFloatRegisterFetchRSEntries[id].insert(fReg);
+        }
     }
 
     void StatsLogger::logStallRAMRead(std::size_t id, std::size_t address) {
         if (!loggingEnabled_)
             return;
-        currentTick().stallRAMReadRSEntries[id].insert(address);
+        tickEvents_[id].ramReadStalls.insert(address);
+        trace(id, TraceEvent::Kind::RAMReadStall, address);
+        if (!streaming_) {
+            currentTick().stallRAMReadRSEntries[id].insert(address);
+        }
     }
 
     void StatsLogger::logExecuting(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        currentTick().executingRSEntries.push_back(id);
+        tickEvents_[id].executing = true;
+        trace(id, TraceEvent::Kind::Executing);
+        if (!streaming_) {
+            currentTick().executingRSEntries.push_back(id);
+        }
     }
 
     void StatsLogger::logRetirement(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        currentTick().retiredRSEntries.push_back(id);
+        trace(id, TraceEvent::Kind::Retirement);
+        if (!streaming_) {
+            currentTick().retiredRSEntries.push_back(id);
+        }
+        // Retired entry logs nothing more, so its lifetime is complete with the events of this tick
+        auto& events = tickEvents_[id];
+        events.retired = true;
+        addTickEvents(id, events);
+        tickEvents_.erase(id);
     }
 
     void StatsLogger::logClearSpeculation(std::size_t id) {
         if (!loggingEnabled_)
             return;
-        instructions_.erase(id);
+        trace(id, TraceEvent::Kind::ClearSpeculation);
+        inFlight_.erase(id);
+        tickEvents_.erase(id);
+        if (streaming_) {
+            --streamedInstructions_;
+        } else {
+            instructions_.erase(id);
+        }
+    }
+
+    void StatsLogger::finishInstruction(std::size_t id) {
+        if (!loggingEnabled_)
+            return;
+        inFlight_.erase(id);
+        tickEvents_.erase(id);
+    }
+
+    void StatsLogger::logRegisterPressureStall() {
+        if (!loggingEnabled_)
+            return;
+        ++registerOccupancy_.pressureStalls;
+        registerOccupancy_.lastPressureStall = true;
+    }
+
+    void StatsLogger::logPhysicalRegisters(std::size_t inUse, std::size_t total) {
+        if (!loggingEnabled_)
+            return;
+        registerOccupancy_.total = total;
+        registerOccupancy_.peak = std::max(registerOccupancy_.peak, inUse);
+        registerOccupancy_.accumulated += inUse;
+        registerOccupancy_.lastInUse = inUse;
+        ++registerOccupancy_.ticks;
+    }
+
+    void StatsLogger::logBranchPrediction(bool correct) {
+        if (!loggingEnabled_)
+            return;
+        ++branchPredictions_.jumps;
+        if (!correct) {
+            ++branchPredictions_.mispredictions;
+        }
+    }
+
+    void StatsLogger::logReturnPrediction(bool hit) {
+        if (!loggingEnabled_)
+            return;
+        if (hit) {
+            ++branchPredictions_.returnHits;
+        } else {
+            ++branchPredictions_.returnMisses;
+        }
+    }
+
+    void StatsLogger::logBranchTargetPrediction(std::size_t pc, bool hit) {
+        if (!loggingEnabled_)
+            return;
+        auto& targets = branchTargets_[pc];
+        ++targets.lookups;
+        if (hit) {
+            ++targets.hits;
+        }
+    }
+
+    void StatsLogger::logSpeculativeLoad() {
+        if (!loggingEnabled_)
+            return;
+        ++loadSpeculation_.loads;
+    }
+
+    void StatsLogger::logMemoryOrderViolation() {
+        if (!loggingEnabled_)
+            return;
+        ++loadSpeculation_.violations;
+    }
+
+    void StatsLogger::logFunctionalUnitIssue(const std::string& pool) {
+        if (!loggingEnabled_)
+            return;
+        ++functionalUnits_[pool].issued;
+    }
+
+    void StatsLogger::logFunctionalUnitStall(const std::string& pool) {
+        if (!loggingEnabled_)
+            return;
+        auto& use = functionalUnits_[pool];
+        ++use.stalls;
+        lastFunctionalUnitStalls_.push_back(&use);
+    }
+
+    void StatsLogger::logRetireWidthStall(std::size_t waiting) {
+        if (!loggingEnabled_)
+            return;
+        ++retireWidthStalls_.ticks;
+        retireWidthStalls_.delayed += waiting;
+    }
+
+    void StatsLogger::logBranchRecovery(std::size_t squashed) {
+        if (!loggingEnabled_)
+            return;
+        ++branchPredictions_.recoveries;
+        branchPredictions_.squashed += squashed;
+    }
+
+    void StatsLogger::logLoadReplay() {
+        if (!loggingEnabled_)
+            return;
+        ++loadSpeculation_.replays;
     }
 
     std::size_t StatsLogger::registerNewInstruction(std::size_t pc, const Instruction* instruction) {
         if (!loggingEnabled_)
             return 0;
-        instructions_.emplace(id_, std::make_pair(pc, instruction));
+        inFlight_.emplace(id_, instruction);
+        trace(id_, TraceEvent::Kind::Instruction, pc);
+        if (streaming_) {
+            ++streamedInstructions_;
+        } else {
+            instructions_.emplace(id_, std::make_pair(pc, instruction));
+        }
         return id_++;
     }
 
     void StatsLogger::newTick() {
         if (!loggingEnabled_)
             return;
-        ticks_.emplace_back();
+        finishTick();
+        if (streaming_) {
+            ++streamedTicks_;
+        } else {
+            ticks_.emplace_back();
+        }
+        registerOccupancy_.lastPressureStall = false;
+        lastFunctionalUnitStalls_.clear();
+    }
+
+    void StatsLogger::repeatTick(std::size_t count) {
+        if (!loggingEnabled_ || count == 0)
+            return;
+        trace(0, TraceEvent::Kind::RepeatTick, count);
+        tickRepeats_ += count;
+        if (streaming_) {
+            streamedTicks_ += count;
+        } else {
+            assert(!ticks_.empty());
+            ticks_.reserve(ticks_.size() + count);
+            for (std::size_t i = 0; i < count; ++i) {
+                ticks_.push_back(ticks_.back());
+            }
+        }
+        registerOccupancy_.accumulated += registerOccupancy_.lastInUse * count;
+        registerOccupancy_.ticks += count;
+        if (registerOccupancy_.lastPressureStall) {
+            registerOccupancy_.pressureStalls += count;
+        }
+        for (auto* use : lastFunctionalUnitStalls_) {
+            use->stalls += count;
+        }
     }
 
     std::size_t StatsLogger::tickCount() const {
-        return ticks_.size();
+        return streaming_ ? streamedTicks_ : ticks_.size();
     }
 
     void StatsLogger::processBasicStats(std::ostream& os) {
-        std::size_t totalTicks = ticks_.size();
+        std::size_t totalTicks = tickCount();
+        std::size_t totalInstructions = streaming_ ? streamedInstructions_ : instructions_.size();
         // std::size_t totalInstructions = instructions_.size();
         // std::unordered_map<std::size_t, InstructionLifeTime> lifetimes;
         // std::map<Instruction::Signature, std::pair<InstructionLifeTime, std::size_t>> lifetimesBySignature;
@@ -117,10 +310,82 @@ namespace tiny::t86 {
         // }
         os << "------------------------------------------\n";
         os << "Total ticks: " << totalTicks << std::endl;
-        os << "Total instructions executed: " << instructions_.size() << std::endl;
-        double throughput = static_cast<double>(instructions_.size()) / totalTicks;
+        os << "Total instructions executed: " << totalInstructions << std::endl;
+        double throughput = static_cast<double>(totalInstructions) / totalTicks;
         os << "Throughput: " << throughput << " instructions per tick\n";
         os << "Average instruction latency: " << 1 / throughput << " ticks\n";
+        if (registerOccupancy_.ticks != 0) {
+            os << "Physical registers in use: " << static_cast<double>(registerOccupancy_.accumulated) / registerOccupancy_.ticks
+               << " on average, " << registerOccupancy_.peak << " at peak, out of " << registerOccupancy_.total << '\n';
+            os << "Register pressure stalls: " << registerOccupancy_.pressureStalls << " ticks\n";
+        }
+        for (const auto& [pool, use] : functionalUnits_) {
+            os << "Functional unit " << pool << ": " << use.issued << " issued, " << use.stalls << " stalls on busy units\n";
+        }
+        if (retireWidthStalls_.ticks != 0) {
+            os << "Retire width bottleneck: " << retireWidthStalls_.ticks << " ticks (" << 100.0 * retireWidthStalls_.ticks / tickCount()
+               << "%), " << static_cast<double>(retireWidthStalls_.delayed) / retireWidthStalls_.ticks
+               << " finished instructions left waiting on average\n";
+        }
+        if (branchPredictions_.jumps != 0) {
+            os << "Branch mispredictions: " << branchPredictions_.mispredictions << " out of " << branchPredictions_.jumps << " jumps\n";
+        }
+        if (branchPredictions_.returnHits + branchPredictions_.returnMisses != 0) {
+            os << "Return address stack: " << branchPredictions_.returnHits << " hits, " << branchPredictions_.returnMisses << " misses\n";
+        }
+        if (branchPredictions_.recoveries != 0) {
+            os << "Branch recoveries at execute: " << branchPredictions_.recoveries << ", squashed instructions: " << branchPredictions_.squashed << '\n';
+        }
+        for (const auto& [pc, targets] : branchTargets_) {
+            os << "Branch target buffer at " << pc << ": " << targets.hits << " hits out of " << targets.lookups
+               << " (" << 100.0 * targets.hits / targets.lookups << "%)\n";
+        }
+        if (loadSpeculation_.loads != 0) {
+            os << "Speculative loads: " << loadSpeculation_.loads << ", memory order violations: " << loadSpeculation_.violations
+               << ", replays: " << loadSpeculation_.replays << '\n';
+        }
+        for (const auto& [cache, use] : caches_) {
+            std::size_t accesses = use.hits + use.merges + use.misses;
+            if (accesses == 0) {
+                continue;
+            }
+            os << "Cache " << cache << ": " << accesses << " accesses, " << use.hits << " hits (" << 100.0 * use.hits / accesses
+               << "%), " << use.misses << " misses, " << use.merges << " merged into outstanding misses, "
+               << use.writeBacks << " write-backs\n";
+            if (use.mshrWaits != 0) {
+                os << "Cache " << cache << " MSHRs full: " << use.mshrWaits << " misses waited " << use.mshrWaitTicks << " ticks\n";
+            }
+            if (!use.missLatencies.empty()) {
+                os << "Cache " << cache << " miss latencies:";
+                const char* separator = " ";
+                for (const auto& [latency, count] : use.missLatencies) {
+                    os << separator << latency << " ticks x" << count;
+                    separator = ", ";
+                }
+                os << '\n';
+            }
+        }
+        for (const auto& [bank, use] : memoryBanks_) {
+            os << "Memory bank " << bank << ": " << use.rowHits + use.rowEmpty + use.rowConflicts << " accesses, "
+               << use.rowHits << " row hits, " << use.rowEmpty << " rows opened, " << use.rowConflicts << " row conflicts, busy "
+               << use.busyTicks << " ticks (" << 100.0 * use.busyTicks / tickCount() << "%), accesses waited " << use.waitTicks << " ticks\n";
+        }
+        if (memoryPorts_.readStalls + memoryPorts_.delayedWrites != 0) {
+            os << "Memory ports: " << memoryPorts_.readStalls << " reads refused, " << memoryPorts_.delayedWrites
+               << " writes delayed by " << memoryPorts_.writeDelayTicks << " ticks\n";
+        }
+        if (prefetches_.issued + prefetches_.dropped != 0) {
+            os << "Prefetches: " << prefetches_.issued << " issued, " << prefetches_.dropped << " dropped, " << prefetches_.useful
+               << " useful, " << prefetches_.late << " late, " << prefetches_.useless << " useless\n";
+            if (prefetches_.softwareIssued + prefetches_.softwareDropped != 0) {
+                os << "Prefetch instructions: " << prefetches_.softwareIssued << " issued, " << prefetches_.softwareDropped << " dropped\n";
+            }
+            if (prefetches_.reads != 0) {
+                std::size_t covered = prefetches_.useful + prefetches_.late;
+                os << "Prefetch coverage: " << covered << " of " << prefetches_.reads << " memory reads ("
+                   << 100.0 * covered / prefetches_.reads << "%)\n";
+            }
+        }
         // os << "Global averages:\n";
         // processAverageLifetime(os, accumulativeInstructionLifeTime, totalInstructions);
         std::cerr << std::flush;
@@ -129,34 +394,151 @@ namespace tiny::t86 {
     void StatsLogger::processDetailedStats(std::ostream& os) {
         // std::size_t totalTicks = ticks_.size();
         // std::size_t totalInstructions = instructions_.size();
-        std::unordered_map<std::size_t, InstructionLifeTime> lifetimes;
-        std::map<Instruction::Signature, std::pair<InstructionLifeTime, std::size_t>> lifetimesBySignature;
-        InstructionLifeTime accumulativeInstructionLifeTime;
-        for (const auto& [id, ins] : instructions_) {
-            InstructionLifeTime lt = getInstructionLifeTime(id);
-            accumulativeInstructionLifeTime += lt;
-            lifetimes.emplace(id, lt);
-            auto& signatureEntry = lifetimesBySignature[instructions_.at(id).second->getSignature()];
-            signatureEntry.first += lt;
-            signatureEntry.second += 1;
-        }
+        // Lifetimes were added up as the instructions retired
+        finishTick();
         os << "------------------------------------------\n";
-        for (const auto& [signature, entry] : lifetimesBySignature) {
+        for (const auto& [signature, entry] : signatureLifeTimes_) {
             const auto& [lt, count] = entry;
             os << "Averages for " << signature.toString() << ":\n";
             processAverageLifetime(os, lt, count);
         }
     }
 
-    void StatsLogger::enableLoggingAndReset() {
+    void StatsLogger::logCacheHit(const std::string& cache) {
+        if (!loggingEnabled_)
+            return;
+        ++caches_[cache].hits;
+    }
+
+    void StatsLogger::logCacheMerge(const std::string& cache) {
+        if (!loggingEnabled_)
+            return;
+        ++caches_[cache].merges;
+    }
+
+    void StatsLogger::logCacheMiss(const std::string& cache, std::size_t latency) {
+        if (!loggingEnabled_)
+            return;
+        auto& use = caches_[cache];
+        ++use.misses;
+        ++use.missLatencies[latency];
+    }
+
+    void StatsLogger::logCacheWriteBack(const std::string& cache) {
+        if (!loggingEnabled_)
+            return;
+        ++caches_[cache].writeBacks;
+    }
+
+    void StatsLogger::logCacheMshrWait(const std::string& cache, std::size_t ticks) {
+        if (!loggingEnabled_)
+            return;
+        auto& use = caches_[cache];
+        ++use.mshrWaits;
+        use.mshrWaitTicks += ticks;
+    }
+
+    void StatsLogger::logMemoryBankAccess(std::size_t bank, RowBuffer row, std::size_t waited, std::size_t busy) {
+        if (!loggingEnabled_)
+            return;
+        auto& use = memoryBanks_[bank];
+        switch (row) {
+            case RowBuffer::Hit:
+                ++use.rowHits;
+                break;
+            case RowBuffer::Empty:
+                ++use.rowEmpty;
+                break;
+            case RowBuffer::Conflict:
+                ++use.rowConflicts;
+                break;
+        }
+        use.waitTicks += waited;
+        use.busyTicks += busy;
+    }
+
+    void StatsLogger::logReadPortStall() {
+        if (!loggingEnabled_)
+            return;
+        ++memoryPorts_.readStalls;
+    }
+
+    void StatsLogger::logWritePortDelay(std::size_t ticks) {
+        if (!loggingEnabled_)
+            return;
+        ++memoryPorts_.delayedWrites;
+        memoryPorts_.writeDelayTicks += ticks;
+    }
+
+    void StatsLogger::logPrefetch(bool issued, bool software) {
+        if (!loggingEnabled_)
+            return;
+        ++(issued ? prefetches_.issued : prefetches_.dropped);
+        if (software) {
+            ++(issued ? prefetches_.softwareIssued : prefetches_.softwareDropped);
+        }
+    }
+
+    void StatsLogger::logMemoryRead() {
+        if (!loggingEnabled_)
+            return;
+        ++prefetches_.reads;
+    }
+
+    void StatsLogger::logPrefetchUse(bool late) {
+        if (!loggingEnabled_)
+            return;
+        ++(late ? prefetches_.late : prefetches_.useful);
+    }
+
+    void StatsLogger::logUselessPrefetch() {
+        if (!loggingEnabled_)
+            return;
+        ++prefetches_.useless;
+    }
+
+    void StatsLogger::enableLoggingAndReset(bool streaming) {
         loggingEnabled_ = true;
+        streaming_ = streaming;
         reset();
     }
 
+    void StatsLogger::enableTrace(const std::string& path, bool mapped) {
+        trace_ = std::make_unique<TraceWriter>(path, mapped);
+    }
+
+    void StatsLogger::closeTrace() {
+        trace_.reset();
+    }
+
+    void StatsLogger::trace(std::size_t id, TraceEvent::Kind kind, uint64_t payload) {
+        if (trace_) {
+            // Logging happens after newTick, so the current tick is the last one counted
+            trace_->write({tickCount() - 1, id, kind, payload});
+        }
+    }
+
     void StatsLogger::reset() {
         ticks_.clear();
         instructions_.clear();
+        streamedTicks_ = 0;
+        streamedInstructions_ = 0;
+        inFlight_.clear();
+        tickEvents_.clear();
+        tickRepeats_ = 0;
+        signatureLifeTimes_.clear();
         id_ = 0;
+        registerOccupancy_ = {};
+        loadSpeculation_ = {};
+        branchPredictions_ = {};
+        retireWidthStalls_ = {};
+        functionalUnits_.clear();
+        lastFunctionalUnitStalls_.clear();
+        branchTargets_.clear();
+        caches_.clear();
+        memoryBanks_.clear();
+        memoryPorts_ = {};
+        prefetches_ = {};
     }
 
     StatsLogger::TickStats& StatsLogger::currentTick() {
@@ -200,62 +582,102 @@ namespace tiny::t86 {
            << "    Average retirement: " << static_cast<double>(lt.retirement) / totalCount << " ticks\n";
     }
 
-    StatsLogger::InstructionLifeTime StatsLogger::getInstructionLifeTime(std::size_t id) {
-        InstructionLifeTime lifeTime;
-        auto it = ticks_.cbegin();
-        // Skip to where the instruction appears for the first time
-        while(it != ticks_.end() && it->instructionFetchPc != id) {
-            ++it;
-        }
-        assert(it != ticks_.end());
-        while(it != ticks_.end() && it->instructionFetchPc == id) {
-            ++lifeTime.fetch;
-            ++it;
-        }
-        while(it != ticks_.end() && it->instructionDecodePc == id) {
-            ++lifeTime.decode;
-            ++it;
-        }
-        while(it != ticks_.end() &&
-              // Please, C++20 be here soon, so I can just replace this with contains
-              std::find(it->operandFetchingRSEntries.begin(), it->operandFetchingRSEntries.end(), id) != it->operandFetchingRSEntries.end()) {
-            ++lifeTime.preparing;
-            if (std::find(it->operandFetchingStallRSEntries.begin(), it->operandFetchingStallRSEntries.end(), id) != it->operandFetchingStallRSEntries.end()) {
-                ++lifeTime.fetchingStalls;
-            }
-            if (auto rsIt = it->stallRegisterFetchRSEntries.find(id); rsIt != it->stallRegisterFetchRSEntries.end()) {
-                for (Register reg : rsIt->second) {
-                    ++lifeTime.waitingForRegisterFetch[reg];
-                }
+    void StatsLogger::addTicks(InFlightInstruction& instruction, const TickEvents& events, std::size_t ticks) {
+        InstructionLifeTime& lifeTime = instruction.lifeTime;
+        // A phase lasts while its event is logged every tick, the first tick without it belongs to the next phases
+        while (true) {
+            switch (instruction.phase) {
+                case Phase::BeforeFetch:
+                    if (!events.fetch) {
+                        return;
+                    }
+                    instruction.phase = Phase::Fetch;
+                    break;
+                case Phase::Fetch:
+                    if (events.fetch) {
+                        lifeTime.fetch += ticks;
+                        return;
+                    }
+                    instruction.phase = Phase::Decode;
+                    break;
+                case Phase::Decode:
+                    if (events.decode) {
+                        lifeTime.decode += ticks;
+                        return;
+                    }
+                    instruction.phase = Phase::Preparing;
+                    break;
+                case Phase::Preparing:
+                    if (events.operandFetching) {
+                        lifeTime.preparing += ticks;
+                        if (events.operandFetchingStall) {
+                            lifeTime.fetchingStalls += ticks;
+                        }
+                        for (Register reg : events.registerFetchStalls) {
+                            lifeTime.waitingForRegisterFetch[reg] += ticks;
+                        }
+                        for (FloatRegister fReg : events.floatRegisterFetchStalls) {
+                            lifeTime.waitingForFloatRegisterFetch[fReg] += ticks;
+                        }
+                        for (std::size_t address : events.ramReadStalls) {
+                            lifeTime.waitingForMemoryRead[address] += ticks;
+                        }
+                        return;
+                    }
+                    instruction.phase = Phase::WaitingForAlu;
+                    break;
+                case Phase::WaitingForAlu:
+                    if (events.noAlu) {
+                        lifeTime.waitingForAlu += ticks;
+                        return;
+                    }
+                    instruction.phase = Phase::Executing;
+                    break;
+                case Phase::Executing:
+                    if (events.executing) {
+                        lifeTime.executing += ticks;
+                        return;
+                    }
+                    instruction.phase = Phase::WaitingForRetirement;
+                    break;
+                case Phase::WaitingForRetirement:
+                    if (events.retirementStall) {
+                        lifeTime.waitingForRetirement += ticks;
+                        return;
+                    }
+                    instruction.phase = Phase::Retirement;
+                    break;
+                case Phase::Retirement:
+                    assert(events.retired);
+                    ++lifeTime.retirement;
+                    instruction.phase = Phase::Retired;
+                    return;
+                case Phase::Retired:
+                    return;
             }
-            if (auto frsIt = it->stallFloatRegisterFetchRSEntries.find(id); frsIt != it->stallFloatRegisterFetchRSEntries.end()) {
-                for (FloatRegister fReg : frsIt->second) {
-                    ++lifeTime.waitingForFloatRegisterFetch[fReg];
-                }
-            }
-            if (auto memIt = it->stallRAMReadRSEntries.find(id); memIt != it->stallRAMReadRSEntries.end()) {
-                for (std::size_t address : memIt->second) {
-                    ++lifeTime.waitingForMemoryRead[address];
-                }
-            }
-            ++it;
         }
-        while(it != ticks_.end() &&
-              std::find(it->stallNoAluRSEntries.begin(), it->stallNoAluRSEntries.end(), id) != it->stallNoAluRSEntries.end()) {
-            ++lifeTime.waitingForAlu;
-            ++it;
+    }
+
+    void StatsLogger::addTickEvents(std::size_t id, const TickEvents& events) {
+        auto it = inFlight_.find(id);
+        if (it == inFlight_.end()) {
+            // Already retired, later events do not belong to its lifetime
+            return;
         }
-        while(it != ticks_.end() && std::find(it->executingRSEntries.begin(), it->executingRSEntries.end(), id) != it->executingRSEntries.end()) {
-            ++lifeTime.executing;
-            ++it;
+        addTicks(it->second, events, tickRepeats_ + 1);
+        if (it->second.phase == Phase::Retired) {
+            auto& signatureEntry = signatureLifeTimes_[it->second.instruction->getSignature()];
+            signatureEntry.first += it->second.lifeTime;
+            signatureEntry.second += 1;
+            inFlight_.erase(it);
         }
-        while(it != ticks_.end() && std::find(it->stallRetirementRSEntries.begin(), it->stallRetirementRSEntries.end(), id) != it->stallRetirementRSEntries.end()) {
-            ++lifeTime.waitingForRetirement;
-            ++it;
+    }
+
+    void StatsLogger::finishTick() {
+        for (const auto& [id, events] : tickEvents_) {
+            addTickEvents(id, events);
         }
-        assert(it != ticks_.end());
-        assert(std::find(it->retiredRSEntries.begin(), it->retiredRSEntries.end(), id) != it->retiredRSEntries.end());
-        ++lifeTime.retirement;
-        return lifeTime;
+        tickEvents_.clear();
+        tickRepeats_ = 0;
     }
 }
@@ -3,26 +3,42 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <string>
 #include <optional>
 #include <unordered_map>
+#include <memory>
 
 #include "../cpu/register.h"
+#include "../instruction.h"
+#include "trace.h"
 
 namespace tiny::t86 {
-    // Forward declare instruction
-    class Instruction;
-
     class StatsLogger {
     public:
         static StatsLogger& instance();
 
-        void enableLoggingAndReset();
+        // Streaming logging keeps only running totals, so its memory does not grow with the length of the run
+        void enableLoggingAndReset(bool streaming = false);
+
+        bool loggingEnabled() const {
+            return loggingEnabled_;
+        }
 
         // Resets all the stats, should be called before every new run
         void reset();
 
+        // Writes every instruction event to a binary trace file too, needs logging enabled
+        // Mapped writes the file through a memory mapping instead of a buffer
+        void enableTrace(const std::string& path, bool mapped = false);
+
+        // Writes out the rest of the trace and closes it
+        void closeTrace();
+
         void newTick();
 
+        // Logs count more ticks exactly the same as the current one, used when the cpu skips idle ticks
+        void repeatTick(std::size_t count);
+
         std::size_t registerNewInstruction(std::size_t pc, const Instruction* instruction);
 
         void logInstructionFetch(std::size_t id);
@@ -52,15 +68,100 @@ namespace tiny::t86 {
 
         void logClearSpeculation(std::size_t id);
 
+        // Instruction was executed and retired outside of the pipeline, as in the functional mode
+        // It logs nothing more and has no lifetime to add to the totals
+        void finishInstruction(std::size_t id);
+
+        // Decoded instruction could not be renamed, there were not enough free physical registers
+        void logRegisterPressureStall();
+
+        // Called once per tick
+        void logPhysicalRegisters(std::size_t inUse, std::size_t total);
+
+        // Called when a jump retires
+        void logBranchPrediction(bool correct);
+
+        // Called when a return predicted by the return address stack retires
+        void logReturnPrediction(bool hit);
+
+        // Instruction started executing on a unit of the pool, only logged with typed pools
+        void logFunctionalUnitIssue(const std::string& pool);
+
+        // Ready instruction found no free unit of its pool this tick, only logged with typed pools
+        void logFunctionalUnitStall(const std::string& pool);
+
+        // Retire width was used up while more finished instructions waited at the head
+        void logRetireWidthStall(std::size_t waiting);
+
+        // Mispredicted jump was repaired when it executed, the younger instructions were thrown away
+        void logBranchRecovery(std::size_t squashed);
+
+        // Called when a taken jump, whose target was looked up in the branch target buffer, retires
+        void logBranchTargetPrediction(std::size_t pc, bool hit);
+
+        // Load read memory while an older store did not know its address
+        void logSpeculativeLoad();
+
+        // Older store turned out to write to the address a speculative load already read
+        void logMemoryOrderViolation();
+
+        // Violating load was thrown away along with younger instructions
+        void logLoadReplay();
+
+        // Data cache access found its line
+        void logCacheHit(const std::string& cache);
+
+        // Data cache access found its line still arriving from an outstanding miss
+        void logCacheMerge(const std::string& cache);
+
+        // Data cache access missed, the line arrives after the latency
+        void logCacheMiss(const std::string& cache, std::size_t latency);
+
+        // Dirty line was evicted from the data cache
+        void logCacheWriteBack(const std::string& cache);
+
+        // Miss waited the ticks for a free MSHR
+        void logCacheMshrWait(const std::string& cache, std::size_t ticks);
+
+        enum class RowBuffer {
+            Hit, Empty, Conflict
+        };
+
+        // Banked ram access waited for the bank and then kept it busy for the ticks
+        void logMemoryBankAccess(std::size_t bank, RowBuffer row, std::size_t waited, std::size_t busy);
+
+        // Read was refused, the read ports of the tick were used up
+        void logReadPortStall();
+
+        // Write started the ticks later, the write ports were used up
+        void logWritePortDelay(std::size_t ticks);
+
+        // Prefetcher or a PREFETCH instruction asked for an address, it was issued unless it was already on its way or the ram had no free gate
+        void logPrefetch(bool issued, bool software);
+
+        // Load started reading the ram, either on its own or from a prefetch
+        void logMemoryRead();
+
+        // Load read a prefetched address, late if the prefetch had not arrived yet
+        void logPrefetchUse(bool late);
+
+        // Prefetched address was thrown out before any load read it
+        void logUselessPrefetch();
+
         std::size_t tickCount() const;
 
+        // Instructions registered but not yet retired, cleared or finished
+        std::size_t instructionsInFlight() const {
+            return inFlight_.size();
+        }
+
         void processBasicStats(std::ostream& os);
 
         void processDetailedStats(std::ostream& os);
 
         struct TickStats {
-            std::optional<std::size_t> instructionFetchPc;
-            std::optional<std::size_t> instructionDecodePc;
+            std::vector<std::size_t> instructionFetchIds;
+            std::vector<std::size_t> instructionDecodeIds;
             std::vector<std::size_t> activeRSEntries;
 
             std::vector<std::size_t> operandFetchingRSEntries;
@@ -119,7 +220,44 @@ namespace tiny::t86 {
             }
         };
 
-        InstructionLifeTime getInstructionLifeTime(std::size_t id);
+        // What one instruction was logged doing in the current tick
+        struct TickEvents {
+            bool fetch{false};
+            bool decode{false};
+            bool operandFetching{false};
+            bool operandFetchingStall{false};
+            std::set<Register> registerFetchStalls;
+            std::set<FloatRegister> floatRegisterFetchStalls;
+            std::set<std::size_t> ramReadStalls;
+            bool noAlu{false};
+            bool executing{false};
+            bool retirementStall{false};
+            bool retired{false};
+        };
+
+        // Phases of the lifetime in the order the instruction goes through them
+        enum class Phase {
+            BeforeFetch, Fetch, Decode, Preparing, WaitingForAlu, Executing, WaitingForRetirement, Retirement, Retired
+        };
+
+        struct InFlightInstruction {
+            explicit InFlightInstruction(const Instruction* instruction) : instruction(instruction) {}
+
+            const Instruction* instruction;
+            Phase phase{Phase::BeforeFetch};
+            InstructionLifeTime lifeTime;
+        };
+
+        // Adds ticks with the same events to the lifetime, a phase lasts while its event is logged every tick
+        static void addTicks(InFlightInstruction& instruction, const TickEvents& events, std::size_t ticks);
+
+        // Adds the events of the current tick and its repeats to the instruction, a retired one goes to the totals
+        void addTickEvents(std::size_t id, const TickEvents& events);
+
+        // Adds the events of the current tick to all the instructions in flight
+        void finishTick();
+
+        void trace(std::size_t id, TraceEvent::Kind kind, uint64_t payload = 0);
 
         static void processAverageLifetime(std::ostream& os, const InstructionLifeTime& lt, std::size_t totalCount);
 
@@ -134,5 +272,128 @@ namespace tiny::t86 {
 
         // Some ids might be missing, as wrongly speculated ones will be removed
         std::unordered_map<std::size_t, std::pair<std::size_t, const Instruction*>> instructions_;
+
+        bool streaming_{false};
+
+        std::unique_ptr<TraceWriter> trace_;
+
+        // Streaming keeps these instead of the ticks and instructions
+        std::size_t streamedTicks_{0};
+        std::size_t streamedInstructions_{0};
+
+        // Lifetimes are counted as the events arrive, so the detailed stats do not scan the ticks
+        std::unordered_map<std::size_t, InFlightInstruction> inFlight_;
+        std::unordered_map<std::size_t, TickEvents> tickEvents_;
+        // Times the current tick was repeated
+        std::size_t tickRepeats_{0};
+        // Lifetimes of the retired instructions added up
+        std::map<Instruction::Signature, std::pair<InstructionLifeTime, std::size_t>> signatureLifeTimes_;
+
+        struct RegisterOccupancy {
+            std::size_t total{0};
+            std::size_t peak{0};
+            // Sum over all ticks, for the average
+            std::size_t accumulated{0};
+            std::size_t ticks{0};
+            std::size_t pressureStalls{0};
+            // Logged in the current tick, repeated ticks log the same
+            std::size_t lastInUse{0};
+            bool lastPressureStall{false};
+        };
+
+        RegisterOccupancy registerOccupancy_;
+
+        struct LoadSpeculation {
+            std::size_t loads{0};
+            std::size_t violations{0};
+            std::size_t replays{0};
+        };
+
+        LoadSpeculation loadSpeculation_;
+
+        struct BranchPredictions {
+            std::size_t jumps{0};
+            std::size_t mispredictions{0};
+            std::size_t returnHits{0};
+            std::size_t returnMisses{0};
+            std::size_t recoveries{0};
+            std::size_t squashed{0};
+        };
+
+        BranchPredictions branchPredictions_;
+
+        struct RetireWidthStalls {
+            std::size_t ticks{0};
+            // Sum over those ticks of the finished instructions left for later
+            std::size_t delayed{0};
+        };
+
+        RetireWidthStalls retireWidthStalls_;
+
+        struct FunctionalUnitUse {
+            std::size_t issued{0};
+            std::size_t stalls{0};
+        };
+
+        // By the name of the pool
+        std::map<std::string, FunctionalUnitUse> functionalUnits_;
+
+        // Stalls logged in the last tick, repeated for the skipped ticks
+        std::vector<FunctionalUnitUse*> lastFunctionalUnitStalls_;
+
+        struct BranchTargets {
+            std::size_t lookups{0};
+            std::size_t hits{0};
+        };
+
+        // By the pc of the jump
+        std::map<std::size_t, BranchTargets> branchTargets_;
+
+        struct CacheUse {
+            std::size_t hits{0};
+            std::size_t merges{0};
+            std::size_t misses{0};
+            std::size_t writeBacks{0};
+            std::size_t mshrWaits{0};
+            std::size_t mshrWaitTicks{0};
+            // Number of misses by their latency
+            std::map<std::size_t, std::size_t> missLatencies;
+        };
+
+        // By the name of the cache
+        std::map<std::string, CacheUse> caches_;
+
+        struct BankUse {
+            std::size_t rowHits{0};
+            std::size_t rowEmpty{0};
+            std::size_t rowConflicts{0};
+            std::size_t waitTicks{0};
+            std::size_t busyTicks{0};
+        };
+
+        // By the index of the bank
+        std::map<std::size_t, BankUse> memoryBanks_;
+
+        struct MemoryPorts {
+            std::size_t readStalls{0};
+            std::size_t delayedWrites{0};
+            std::size_t writeDelayTicks{0};
+        };
+
+        MemoryPorts memoryPorts_;
+
+        struct Prefetches {
+            std::size_t issued{0};
+            std::size_t dropped{0};
+            // Part of the above asked for by PREFETCH instructions
+            std::size_t softwareIssued{0};
+            std::size_t softwareDropped{0};
+            std::size_t reads{0};
+            std::size_t useful{0};
+            std::size_t late{0};
+            std::size_t useless{0};
+        };
+
+        Prefetches prefetches_;
     };
 }
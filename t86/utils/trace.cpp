@@ -0,0 +1,262 @@
+#include "trace.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#if __has_include(<sys/mman.h>)
+#define T86_TRACE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../cpu/register.h"
+#include "../../common/helpers.h"
+
+namespace tiny::t86 {
+    namespace {
+        constexpr char magic[] = {'T', '8', '6', 'T', 'R', 'A', 'C', 'E'};
+
+        constexpr uint8_t version = 1;
+
+        constexpr std::size_t bufferSize = 64 * 1024;
+
+        // Multiple of the page size
+        constexpr std::size_t mappingSize = 1024 * 1024;
+
+        // Pc, Sp, Bp and Flags have the largest indices
+        constexpr uint64_t specialRegisterCnt = 4;
+
+        uint64_t zigzag(uint64_t delta) {
+            return (delta << 1) ^ (static_cast<int64_t>(delta) < 0 ? ~uint64_t{0} : 0);
+        }
+
+        uint64_t unzigzag(uint64_t value) {
+            return (value >> 1) ^ (~(value & 1) + 1);
+        }
+    }
+
+    const char* TraceEvent::kindName(Kind kind) {
+        switch (kind) {
+            case Kind::Instruction:
+                return "instruction";
+            case Kind::Fetch:
+                return "fetch";
+            case Kind::Decode:
+                return "decode";
+            case Kind::OperandFetching:
+                return "operandFetching";
+            case Kind::FetchStall:
+                return "fetchStall";
+            case Kind::RegisterFetchStall:
+                return "registerFetchStall";
+            case Kind::FloatRegisterFetchStall:
+                return "floatRegisterFetchStall";
+            case Kind::RAMReadStall:
+                return "ramReadStall";
+            case Kind::NoAlu:
+                return "noAlu";
+            case Kind::Executing:
+                return "executing";
+            case Kind::RetirementStall:
+                return "retirementStall";
+            case Kind::Retirement:
+                return "retirement";
+            case Kind::ClearSpeculation:
+                return "clearSpeculation";
+            case Kind::RepeatTick:
+                return "repeatTick";
+        }
+        assert(false && "Unknown trace event kind");
+        return "";
+    }
+
+    bool TraceEvent::hasPayload(Kind kind) {
+        switch (kind) {
+            case Kind::Instruction:
+            case Kind::RegisterFetchStall:
+            case Kind::FloatRegisterFetchStall:
+            case Kind::RAMReadStall:
+            case Kind::RepeatTick:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    std::string TraceEvent::toString() const {
+        if (kind == Kind::RepeatTick) {
+            return utils::format("{} {} {}", tick, kindName(kind), payload);
+        }
+        std::string result = utils::format("{} {} {}", tick, id, kindName(kind));
+        switch (kind) {
+            case Kind::Instruction:
+                return result + " pc " + std::to_string(payload);
+            case Kind::RegisterFetchStall:
+                return result + " " + Register{payload}.toString();
+            case Kind::FloatRegisterFetchStall:
+                return result + " " + FloatRegister{payload}.toString();
+            case Kind::RAMReadStall:
+                return result + " [" + std::to_string(payload) + "]";
+            default:
+                return result;
+        }
+    }
+
+    TraceWriter::TraceWriter(const std::string& path, bool mapped) : mapped_(mapped) {
+        if (mapped_) {
+#ifdef T86_TRACE_MMAP
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd_ < 0) {
+                throw std::runtime_error(utils::format("Unable to open trace file {}", path));
+            }
+            nextWindow();
+#else
+            throw std::runtime_error("Memory mapped traces are not supported on this platform");
+#endif
+        } else {
+            file_.open(path, std::ios::binary | std::ios::trunc);
+            if (!file_) {
+                throw std::runtime_error(utils::format("Unable to open trace file {}", path));
+            }
+            buffer_.resize(bufferSize);
+            begin_ = pos_ = buffer_.data();
+            end_ = begin_ + buffer_.size();
+        }
+        for (char c : magic) {
+            putByte(c);
+        }
+        putByte(version);
+    }
+
+    TraceWriter::~TraceWriter() {
+        close();
+    }
+
+    void TraceWriter::putVarint(uint64_t value) {
+        while (value >= 0x80) {
+            putByte(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        putByte(static_cast<uint8_t>(value));
+    }
+
+    void TraceWriter::write(const TraceEvent& event) {
+        assert(open_);
+        assert(event.tick >= lastTick_);
+        putVarint(event.tick - lastTick_);
+        putVarint(zigzag(event.id - lastId_));
+        putByte(static_cast<uint8_t>(event.kind));
+        if (TraceEvent::hasPayload(event.kind)) {
+            putVarint(event.kind == TraceEvent::Kind::RegisterFetchStall ? event.payload + specialRegisterCnt : event.payload);
+        }
+        lastTick_ = event.tick;
+        lastId_ = event.id;
+    }
+
+    void TraceWriter::nextWindow() {
+        if (!mapped_) {
+            file_.write(reinterpret_cast<const char*>(begin_), pos_ - begin_);
+            written_ += pos_ - begin_;
+            pos_ = begin_;
+            return;
+        }
+#ifdef T86_TRACE_MMAP
+        if (begin_) {
+            munmap(begin_, mappingSize);
+            written_ += mappingSize;
+        }
+        if (ftruncate(fd_, written_ + mappingSize) != 0) {
+            throw std::runtime_error("Unable to grow the trace file");
+        }
+        void* mapping = mmap(nullptr, mappingSize, PROT_WRITE, MAP_SHARED, fd_, written_);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Unable to map the trace file");
+        }
+        begin_ = pos_ = static_cast<uint8_t*>(mapping);
+        end_ = begin_ + mappingSize;
+#endif
+    }
+
+    void TraceWriter::close() {
+        if (!open_) {
+            return;
+        }
+        open_ = false;
+        if (!mapped_) {
+            nextWindow();
+            file_.close();
+            return;
+        }
+#ifdef T86_TRACE_MMAP
+        std::size_t size = bytesWritten();
+        munmap(begin_, mappingSize);
+        // Cuts off the unused end of the last mapping
+        [[maybe_unused]] int result = ftruncate(fd_, size);
+        ::close(fd_);
+        begin_ = pos_ = end_ = nullptr;
+        written_ = size;
+#endif
+    }
+
+    TraceReader::TraceReader(const std::string& path) : file_(path, std::ios::binary) {
+        if (!file_) {
+            throw std::runtime_error(utils::format("Unable to open trace file {}", path));
+        }
+        char header[sizeof(magic) + 1];
+        if (!file_.read(header, sizeof(header)) || std::memcmp(header, magic, sizeof(magic)) != 0) {
+            throw std::runtime_error(utils::format("{} is not a t86 trace", path));
+        }
+        if (static_cast<uint8_t>(header[sizeof(magic)]) != version) {
+            throw std::runtime_error(utils::format("Trace {} has unsupported version {}", path, static_cast<int>(header[sizeof(magic)])));
+        }
+    }
+
+    std::optional<uint64_t> TraceReader::getVarint() {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            int byte = file_.get();
+            if (byte == std::char_traits<char>::eof()) {
+                if (shift == 0) {
+                    return std::nullopt;
+                }
+                throw std::runtime_error("Trace ends in the middle of a record");
+            }
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Trace has a malformed number");
+    }
+
+    std::optional<TraceEvent> TraceReader::next() {
+        auto tickDelta = getVarint();
+        if (!tickDelta) {
+            return std::nullopt;
+        }
+        auto idDelta = getVarint();
+        int kind = file_.get();
+        if (!idDelta || kind == std::char_traits<char>::eof()) {
+            throw std::runtime_error("Trace ends in the middle of a record");
+        }
+        if (static_cast<std::size_t>(kind) >= TraceEvent::kindCnt) {
+            throw std::runtime_error(utils::format("Trace has an unknown event kind {}", kind));
+        }
+        TraceEvent event;
+        event.tick = lastTick_ + *tickDelta;
+        event.id = lastId_ + unzigzag(*idDelta);
+        event.kind = static_cast<TraceEvent::Kind>(kind);
+        if (TraceEvent::hasPayload(event.kind)) {
+            auto payload = getVarint();
+            if (!payload) {
+                throw std::runtime_error("Trace ends in the middle of a record");
+            }
+            event.payload = event.kind == TraceEvent::Kind::RegisterFetchStall ? *payload - specialRegisterCnt : *payload;
+        }
+        lastTick_ = event.tick;
+        lastId_ = event.id;
+        return event;
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tiny::t86 {
+    /**
+     * One event of the pipeline trace, written from the stats logger hooks.
+     * The id is the logging id of the instruction, ticks are counted from 0.
+     */
+    struct TraceEvent {
+        enum class Kind : uint8_t {
+            // Payload is the pc of the new instruction
+            Instruction,
+            Fetch,
+            Decode,
+            OperandFetching,
+            FetchStall,
+            // Payload is the register index
+            RegisterFetchStall,
+            // Payload is the float register index
+            FloatRegisterFetchStall,
+            // Payload is the address
+            RAMReadStall,
+            NoAlu,
+            Executing,
+            RetirementStall,
+            Retirement,
+            ClearSpeculation,
+            // Current tick repeats the payload more times, there is no instruction
+            RepeatTick,
+        };
+
+        static constexpr std::size_t kindCnt = 14;
+
+        static const char* kindName(Kind kind);
+
+        static bool hasPayload(Kind kind);
+
+        uint64_t tick{0};
+        uint64_t id{0};
+        Kind kind{Kind::Instruction};
+        uint64_t payload{0};
+
+        /// Single line of the text form of the trace
+        std::string toString() const;
+
+        bool operator==(const TraceEvent& other) const = default;
+    };
+
+    /**
+     * Writes the trace in the binary form, a header followed by records.
+     * A record is the tick as a delta from the previous record, the id as a zigzag delta from the previous record,
+     * one byte of the kind and the payload if the kind has one, the numbers are LEB128 varints.
+     * Register indices are shifted so that the special registers take the smallest numbers.
+     * Records go through a buffer, or through a memory mapping of the file where mmap is available.
+     */
+    class TraceWriter {
+    public:
+        explicit TraceWriter(const std::string& path, bool mapped = false);
+
+        ~TraceWriter();
+
+        TraceWriter(const TraceWriter&) = delete;
+
+        TraceWriter& operator=(const TraceWriter&) = delete;
+
+        /// Ticks of the events must not decrease
+        void write(const TraceEvent& event);
+
+        /// Writes out the rest of the records and closes the file, the destructor does it too
+        void close();
+
+        std::size_t bytesWritten() const {
+            return written_ + (pos_ - begin_);
+        }
+
+    private:
+        void putByte(uint8_t byte) {
+            if (pos_ == end_) {
+                nextWindow();
+            }
+            *pos_++ = byte;
+        }
+
+        void putVarint(uint64_t value);
+
+        /// Writes out the full buffer, or maps the next part of the file
+        void nextWindow();
+
+        bool mapped_;
+
+        bool open_{true};
+
+        std::ofstream file_;
+
+        std::vector<uint8_t> buffer_;
+
+        int fd_{-1};
+
+        // Part of the buffer or of the mapping that records are written to
+        uint8_t* begin_{nullptr};
+        uint8_t* pos_{nullptr};
+        uint8_t* end_{nullptr};
+
+        // Bytes before the current window
+        std::size_t written_{0};
+
+        uint64_t lastTick_{0};
+        uint64_t lastId_{0};
+    };
+
+    /**
+     * Reads the events back one by one, only a buffer of the file is kept in memory.
+     */
+    class TraceReader {
+    public:
+        explicit TraceReader(const std::string& path);
+
+        /// Next event, nothing at the end of the trace
+        std::optional<TraceEvent> next();
+
+    private:
+        /// Nothing if the file ends before the first byte, throws if it ends inside the number
+        std::optional<uint64_t> getVarint();
+
+        std::ifstream file_;
+
+        uint64_t lastTick_{0};
+        uint64_t lastId_{0};
+    };
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "../t86-cli/parser.h"
+#include "../t86/utils/stats_logger.h"
+
+using namespace tiny::t86;
+
+namespace {
+    Program parse(const std::string& source) {
+        std::istringstream iss(source);
+        Parser parser(iss);
+        return parser.Parse();
+    }
+
+    // Counts R0 down from the given number
+    Program countdown(int iterations) {
+        return parse(utils::format(R"(
+.text
+0 MOV R0, {}
+1 MOV R1, 0
+2 ADD R1, R0
+3 MOV [5], R1
+4 DEC R0
+5 CMP R0, 0
+6 JG 2
+7 HALT
+)", iterations));
+    }
+}
+
+TEST(StatsLoggerTest, FunctionalStepsLeaveNothingInFlight) {
+    StatsLogger::instance().enableLoggingAndReset();
+    Cpu cpu;
+    cpu.start(countdown(100));
+    while (!cpu.halted()) {
+        cpu.step();
+    }
+    ASSERT_EQ(StatsLogger::instance().instructionsInFlight(), 0);
+    StatsLogger::instance().reset();
+}
+
+TEST(StatsLoggerTest, StreamingFunctionalRunStaysBounded) {
+    StatsLogger::instance().enableLoggingAndReset(true);
+    Cpu cpu;
+    cpu.start(countdown(200000));
+    std::size_t peak = 0;
+    while (!cpu.halted()) {
+        cpu.step();
+        peak = std::max(peak, StatsLogger::instance().instructionsInFlight());
+    }
+    ASSERT_EQ(peak, 0);
+    // One tick per instruction, two before the loop, five in it and the halt
+    ASSERT_EQ(StatsLogger::instance().tickCount(), 1000003);
+    StatsLogger::instance().reset();
+}
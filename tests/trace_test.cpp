@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "../t86/utils/trace.h"
+#include "../t86/cpu/register.h"
+
+using namespace tiny::t86;
+
+namespace {
+    std::vector<TraceEvent> sampleEvents() {
+        return {
+            {0, 0, TraceEvent::Kind::Instruction, 0},
+            {0, 0, TraceEvent::Kind::Fetch, 0},
+            {1, 1, TraceEvent::Kind::Instruction, 7},
+            {1, 0, TraceEvent::Kind::Decode, 0},
+            {2, 0, TraceEvent::Kind::RegisterFetchStall, Register::StackPointer().index()},
+            {2, 0, TraceEvent::Kind::RegisterFetchStall, 3},
+            {2, 1, TraceEvent::Kind::FloatRegisterFetchStall, 2},
+            {2, 1, TraceEvent::Kind::RAMReadStall, 1ul << 40},
+            {2, 0, TraceEvent::Kind::RepeatTick, 1000},
+            {1003, 0, TraceEvent::Kind::Retirement, 0},
+            {1003, 1, TraceEvent::Kind::ClearSpeculation, 0},
+        };
+    }
+
+    std::vector<TraceEvent> readAll(const std::string& path) {
+        TraceReader reader(path);
+        std::vector<TraceEvent> events;
+        while (auto event = reader.next()) {
+            events.push_back(*event);
+        }
+        return events;
+    }
+
+    void roundTrip(bool mapped) {
+        std::string path = testing::TempDir() + "trace_test.trc";
+        auto events = sampleEvents();
+        {
+            TraceWriter writer(path, mapped);
+            for (const auto& event : events) {
+                writer.write(event);
+            }
+        }
+        ASSERT_EQ(readAll(path), events);
+        std::remove(path.c_str());
+    }
+
+    void longRoundTrip(bool mapped) {
+        std::string path = testing::TempDir() + "trace_test_long.trc";
+        std::vector<TraceEvent> events;
+        // More than a buffer and a mapping
+        for (uint64_t i = 0; i < 500000; ++i) {
+            events.push_back({i / 3, i % 5 == 0 ? i : i - 2, TraceEvent::Kind::RAMReadStall, i * 1000});
+        }
+        TraceWriter writer(path, mapped);
+        for (const auto& event : events) {
+            writer.write(event);
+        }
+        writer.close();
+        ASSERT_EQ(readAll(path), events);
+        std::remove(path.c_str());
+    }
+}
+
+TEST(TraceTest, BufferedRoundTrip) {
+    roundTrip(false);
+}
+
+TEST(TraceTest, MappedRoundTrip) {
+    roundTrip(true);
+}
+
+TEST(TraceTest, BufferedLongRoundTrip) {
+    longRoundTrip(false);
+}
+
+TEST(TraceTest, MappedLongRoundTrip) {
+    longRoundTrip(true);
+}
+
+TEST(TraceTest, EmptyTrace) {
+    std::string path = testing::TempDir() + "trace_test_empty.trc";
+    TraceWriter(path).close();
+    ASSERT_TRUE(readAll(path).empty());
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, NotATrace) {
+    std::string path = testing::TempDir() + "trace_test_bad.trc";
+    std::ofstream(path) << "MOV R0, 1";
+    ASSERT_THROW(TraceReader{path}, std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, TruncatedRecord) {
+    std::string path = testing::TempDir() + "trace_test_cut.trc";
+    std::size_t firstRecordEnd;
+    {
+        TraceWriter writer(path);
+        writer.write({5, 300, TraceEvent::Kind::Instruction, 1ul << 20});
+        firstRecordEnd = writer.bytesWritten();
+        // Tick delta takes two bytes
+        writer.write({1005, 300, TraceEvent::Kind::Fetch, 0});
+    }
+    std::string content;
+    {
+        std::ifstream file(path, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    // Cut inside the payload of the first record
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content.substr(0, firstRecordEnd - 1);
+    {
+        TraceReader reader(path);
+        ASSERT_THROW(reader.next(), std::runtime_error);
+    }
+    // Cut inside the tick delta of the second record
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content.substr(0, firstRecordEnd + 1);
+    {
+        TraceReader reader(path);
+        ASSERT_TRUE(reader.next());
+        ASSERT_THROW(reader.next(), std::runtime_error);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, TextForm) {
+    ASSERT_EQ((TraceEvent{4, 2, TraceEvent::Kind::RegisterFetchStall, 1}).toString(), "4 2 registerFetchStall Reg1");
+    ASSERT_EQ((TraceEvent{4, 2, TraceEvent::Kind::RAMReadStall, 16}).toString(), "4 2 ramReadStall [16]");
+    ASSERT_EQ((TraceEvent{4, 0, TraceEvent::Kind::RepeatTick, 3}).toString(), "4 repeatTick 3");
+}